@@ -35,6 +35,10 @@
 #include "gdbtk-interp.h"
 #include "arch-utils.h"
 #include "exceptions.h"
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
 
 /* Globals to support action and breakpoint commands.  */
 static Tcl_Obj **gdbtk_obj_array;
@@ -94,16 +98,24 @@ const char *bpdisp[] =
 static int get_point_list (int (*) (const struct breakpoint *),
                            Tcl_Interp *, int, Tcl_Obj * CONST objv[]);
 static int have_masked_watchpoints (void);
+static void bp_index_add (struct breakpoint *);
+static bool bp_index_remove (int);
+static void get_breakpoint_info (Tcl_Interp *, struct breakpoint *,
+				 Tcl_Obj *);
 
 /* Breakpoint-related functions */
 static int gdb_find_bp_at_addr (ClientData, Tcl_Interp *, int,
 				Tcl_Obj * CONST objv[]);
 static int gdb_find_bp_at_line (ClientData, Tcl_Interp *, int,
 				Tcl_Obj * CONST objv[]);
+static int gdb_find_bp_in_file (ClientData, Tcl_Interp *, int,
+				Tcl_Obj * CONST objv[]);
 static int gdb_get_breakpoint_info (ClientData, Tcl_Interp *, int,
 				    Tcl_Obj * CONST[]);
 static int gdb_get_breakpoint_list (ClientData, Tcl_Interp *, int,
 				    Tcl_Obj * CONST[]);
+static int gdb_get_point_info (ClientData, Tcl_Interp *, int,
+			       Tcl_Obj * CONST[]);
 static int gdb_set_bp (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST objv[]);
 
 /* Tracepoint-related functions */
@@ -120,6 +132,8 @@ static int gdb_trace_status (ClientData, Tcl_Interp *, int,
 static int gdb_tracepoint_exists_command (ClientData, Tcl_Interp *,
 					  int, Tcl_Obj * CONST objv[]);
 static Tcl_Obj *get_breakpoint_commands (struct command_line *cmd);
+static void get_tracepoint_info (Tcl_Interp *, struct breakpoint *,
+				 Tcl_Obj *);
 
 static int tracepoint_exists (const char *args);
 
@@ -130,6 +144,8 @@ static int gdb_get_watchpoint_info (ClientData, Tcl_Interp *, int,
 				    Tcl_Obj * CONST[]);
 static int gdb_have_masked_watchpoints (ClientData, Tcl_Interp *, int,
                                         Tcl_Obj * CONST[]);
+static void get_watchpoint_info (Tcl_Interp *, struct breakpoint *,
+				 Tcl_Obj *);
 
 /* Breakpoint/tracepoint/watchpoint events and related functions */
 
@@ -143,15 +159,25 @@ void gdbtk_delete_all_breakpoints (void);
 int
 Gdbtk_Breakpoint_Init (Tcl_Interp *interp)
 {
+  struct breakpoint *b;
+
+  /* Index the breakpoints set before the hooks were installed.  */
+  ALL_BREAKPOINTS (b)
+    bp_index_add (b);
+
   /* Breakpoint commands */
   Tcl_CreateObjCommand (interp, "gdb_find_bp_at_addr", gdbtk_call_wrapper,
 			(ClientData) gdb_find_bp_at_addr, NULL);
   Tcl_CreateObjCommand (interp, "gdb_find_bp_at_line", gdbtk_call_wrapper,
 			(ClientData) gdb_find_bp_at_line, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_find_bp_in_file", gdbtk_call_wrapper,
+			(ClientData) gdb_find_bp_in_file, NULL);
   Tcl_CreateObjCommand (interp, "gdb_get_breakpoint_info", gdbtk_call_wrapper,
 			(ClientData) gdb_get_breakpoint_info, NULL);
   Tcl_CreateObjCommand (interp, "gdb_get_breakpoint_list", gdbtk_call_wrapper,
 			(ClientData) gdb_get_breakpoint_list, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_get_point_info", gdbtk_call_wrapper,
+			(ClientData) gdb_get_point_info, NULL);
   Tcl_CreateObjCommand (interp, "gdb_set_bp", gdbtk_call_wrapper,
 			(ClientData) gdb_set_bp, NULL);
 
@@ -192,6 +218,142 @@ gdbtk_read_next_line (void)
   return  Tcl_GetStringFromObj (gdbtk_obj_array[gdbtk_obj_array_ptr++], NULL);
 }
 
+/* An index of the breakpoints, tracepoints and watchpoints by address
+   and by source line, kept up to date by the breakpoint hooks so that
+   the source window does not walk the breakpoint chain for every line.
+   Like gdb_get_breakpoint_info, only the first location of each point
+   is considered.
+
+   Each change to the index gets a new generation number, so that
+   gdb_get_point_info can tell which points changed since a given
+   generation.  */
+
+struct bp_index_entry
+{
+  /* 'b' for a breakpoint, 't' for a tracepoint, 'w' for a
+     watchpoint.  */
+  char kind;
+
+  bool has_address;
+  CORE_ADDR address;
+
+  /* The symtab file name, empty if the location has no symtab.  */
+  std::string filename;
+  int line;
+
+  /* The generation at which the point was last created or modified.  */
+  unsigned long generation;
+};
+
+/* A point deleted at GENERATION.  */
+
+struct bp_deletion
+{
+  unsigned long generation;
+  int number;
+  char kind;
+};
+
+/* How many deletions to remember.  */
+#define BP_DELETIONS_MAX 1024
+
+static std::map<int, bp_index_entry> bp_index;
+static std::unordered_map<CORE_ADDR, std::set<int>> bp_index_by_address;
+static std::unordered_map<std::string, std::map<int, std::set<int>>>
+  bp_index_by_line;
+static unsigned long bp_generation = 0;
+static std::deque<bp_deletion> bp_deletions;
+
+/* Deletions before this generation are forgotten.  */
+static unsigned long bp_deletions_start = 1;
+
+/* Add B to the index, or update its entry.  */
+
+static void
+bp_index_add (struct breakpoint *b)
+{
+  bp_index_entry entry;
+
+  bp_index_remove (b->number);
+  if (b->number <= 0 || !BREAKPOINT_IS_INTERESTING (b))
+    return;
+
+  entry.kind = is_tracepoint (b) ? 't' : is_watchpoint (b) ? 'w' : 'b';
+  entry.has_address = b->loc != NULL;
+  entry.address = b->loc != NULL ? b->loc->address : 0;
+  entry.line = 0;
+  if (b->loc != NULL && b->loc->symtab != NULL)
+    {
+      entry.filename = b->loc->symtab->filename;
+      entry.line = b->loc->line_number;
+    }
+  entry.generation = ++bp_generation;
+
+  if (entry.has_address)
+    bp_index_by_address[entry.address].insert (b->number);
+  if (!entry.filename.empty ())
+    bp_index_by_line[entry.filename][entry.line].insert (b->number);
+  bp_index[b->number] = std::move (entry);
+}
+
+/* Remove the breakpoint numbered NUMBER from the index.  Return
+   false if it was not there.  */
+
+static bool
+bp_index_remove (int number)
+{
+  auto it = bp_index.find (number);
+
+  if (it == bp_index.end ())
+    return false;
+
+  const bp_index_entry &entry = it->second;
+
+  if (entry.has_address)
+    {
+      auto at = bp_index_by_address.find (entry.address);
+
+      at->second.erase (number);
+      if (at->second.empty ())
+	bp_index_by_address.erase (at);
+    }
+
+  if (!entry.filename.empty ())
+    {
+      auto file = bp_index_by_line.find (entry.filename);
+      auto line = file->second.find (entry.line);
+
+      line->second.erase (number);
+      if (line->second.empty ())
+	file->second.erase (line);
+      if (file->second.empty ())
+	bp_index_by_line.erase (file);
+    }
+
+  bp_index.erase (it);
+  return true;
+}
+
+/* Remove the point numbered NUMBER, which is being deleted, from the
+   index and remember the deletion.  */
+
+static void
+bp_index_delete (int number)
+{
+  auto it = bp_index.find (number);
+
+  if (it == bp_index.end ())
+    return;
+
+  bp_deletions.push_back ({ ++bp_generation, number, it->second.kind });
+  if (bp_deletions.size () > BP_DELETIONS_MAX)
+    {
+      bp_deletions_start = bp_deletions.front ().generation + 1;
+      bp_deletions.pop_front ();
+    }
+  bp_index_remove (number);
+}
+
 /*
  *  This section contains commands for manipulation of breakpoints.
  */
@@ -229,7 +391,6 @@ gdb_find_bp_at_addr (ClientData clientData, Tcl_Interp *interp,
 {
   CORE_ADDR addr;
   Tcl_WideInt waddr;
-  struct breakpoint *b;
 
   if (objc != 2)
     {
@@ -242,12 +403,11 @@ gdb_find_bp_at_addr (ClientData clientData, Tcl_Interp *interp,
   addr = waddr;
 
   Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
-  ALL_BREAKPOINTS (b)
-    {
-      if (b->loc != NULL && b->loc->address == addr)
-	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
-				  Tcl_NewIntObj (b->number));
-    }
+  auto it = bp_index_by_address.find (addr);
+  if (it != bp_index_by_address.end ())
+    for (int number : it->second)
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				Tcl_NewIntObj (number));
 
   return TCL_OK;
 }
@@ -267,7 +427,6 @@ gdb_find_bp_at_line (ClientData clientData, Tcl_Interp *interp,
 {
   struct symtab *s;
   int line;
-  struct breakpoint *b;
 
   if (objc != 3)
     {
@@ -286,15 +445,81 @@ gdb_find_bp_at_line (ClientData clientData, Tcl_Interp *interp,
     }
 
   Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
-  ALL_BREAKPOINTS (b)
-  {
-    if (b->loc && b->loc->symtab && b->loc->line_number == line
-	&& !strcmp (b->loc->symtab->filename, s->filename))
-      {
-	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
-				  Tcl_NewIntObj (b->number));
-      }
-  }
+  auto file = bp_index_by_line.find (s->filename);
+  if (file == bp_index_by_line.end ())
+    return TCL_OK;
+
+  auto it = file->second.find (line);
+  if (it != file->second.end ())
+    for (int number : it->second)
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				Tcl_NewIntObj (number));
+
+  return TCL_OK;
+}
+
+/* This implements the tcl command "gdb_find_bp_in_file"
+
+* Tcl Arguments:
+*    filename: the file in which to find the breakpoints
+*    kind:     "breakpoints", "tracepoints", "watchpoints" or "all"
+*              (the default)
+* Tcl Result:
+*    A list of line numbers, each one followed by the list of the
+*    numbers of the points of that kind at that line, in line order
+*    (suitable for "array set").  It is empty if the file is unknown.
+*/
+static int
+gdb_find_bp_in_file (ClientData clientData, Tcl_Interp *interp,
+		     int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *kinds[] =
+    {"breakpoints", "tracepoints", "watchpoints", "all", NULL};
+  static const char kind_chars[] = "btw";
+  struct symtab *s;
+  int kind = 3;
+
+  if (objc != 2 && objc != 3)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "filename ?kind?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 3
+      && Tcl_GetIndexFromObj (interp, objv[2], kinds, "kind", 0,
+			      &kind) != TCL_OK)
+    {
+      result_ptr->flags = GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  s = lookup_symtab (Tcl_GetStringFromObj (objv[1], NULL));
+  if (s == NULL)
+    return TCL_OK;
+
+  auto file = bp_index_by_line.find (s->filename);
+  if (file == bp_index_by_line.end ())
+    return TCL_OK;
+
+  for (const auto &line : file->second)
+    {
+      Tcl_Obj *numbers = NULL;
+
+      for (int number : line.second)
+	if (kind == 3 || bp_index[number].kind == kind_chars[kind])
+	  {
+	    if (numbers == NULL)
+	      numbers = Tcl_NewListObj (0, NULL);
+	    Tcl_ListObjAppendElement (NULL, numbers, Tcl_NewIntObj (number));
+	  }
+
+      if (numbers == NULL)
+	continue;
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				Tcl_NewIntObj (line.first));
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, numbers);
+    }
 
   return TCL_OK;
 }
@@ -312,12 +537,8 @@ static int
 gdb_get_breakpoint_info (ClientData clientData, Tcl_Interp *interp, int objc,
 			 Tcl_Obj *CONST objv[])
 {
-  struct symtab_and_line sal;
   int bpnum;
   struct breakpoint *b;
-  const char *funcname, *filename;
-  const char *addr_string;
-  int isPending = 0;
 
   if (objc != 2)
     {
@@ -338,8 +559,22 @@ gdb_get_breakpoint_info (ClientData clientData, Tcl_Interp *interp, int objc,
       return TCL_ERROR;
     }
 
-  isPending = (b->loc == NULL);
   Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  get_breakpoint_info (interp, b, result_ptr->obj_ptr);
+  return TCL_OK;
+}
+
+/* Append the fields of gdb_get_breakpoint_info for B to LIST.  */
+
+static void
+get_breakpoint_info (Tcl_Interp *interp, struct breakpoint *b, Tcl_Obj *list)
+{
+  struct symtab_and_line sal;
+  const char *funcname, *filename;
+  const char *addr_string;
+  int isPending = 0;
+
+  isPending = (b->loc == NULL);
   /* Pending breakpoints will display "<PENDING>" as the file name and the
      user expression into the Function field of the breakpoint view.
     "0" and "0" in the line number and address field.  */
@@ -347,13 +582,13 @@ gdb_get_breakpoint_info (ClientData clientData, Tcl_Interp *interp, int objc,
     {
       addr_string = event_location_to_string(b->location.get ());
 
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewStringObj ("<PENDING>", -1));
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewStringObj (addr_string, -1));
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewIntObj (0));
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewIntObj (0));
     }
   else
@@ -363,39 +598,37 @@ gdb_get_breakpoint_info (ClientData clientData, Tcl_Interp *interp, int objc,
       filename = symtab_to_filename (sal.symtab);
       if (filename == NULL)
         filename = "";
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewStringObj (filename, -1));
       funcname = pc_function_name (b->loc->address);
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewStringObj (funcname, -1));
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewIntObj (b->loc->line_number));
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+      Tcl_ListObjAppendElement (NULL, list,
                                 Tcl_NewStringObj (core_addr_to_string
                                (b->loc->address), -1));
   }
 
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (bptypes[b->type], -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewBooleanObj (b->enable_state == bp_enabled));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (bpdisp[b->disposition], -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (b->ignore_count));
 
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    get_breakpoint_commands (breakpoint_commands (b)));
 
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (b->cond_string, -1));
 
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (b->thread));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (b->hit_count));
-
-  return TCL_OK;
 }
 
 /* Helper function for gdb_get_breakpoint_info, this function is
@@ -516,6 +749,144 @@ gdb_get_breakpoint_list (ClientData clientData, Tcl_Interp *interp,
   return get_point_list (is_breakpoint, interp, objc, objv);
 }
 
+/* This implements the tcl command gdb_get_point_info
+ * It returns the information of all the points of a kind at once, in
+ * columns, rather than one gdb_get_breakpoint_info (or tracepoint or
+ * watchpoint) call per point.
+ *
+ * Tcl Arguments:
+ *    -file filename: optional, only return the points in FILENAME.
+ *    kind: breakpoints, tracepoints or watchpoints.
+ *    since: optional generation, as returned by a previous call.  Only
+ *      the points created or modified after it are then returned.
+ * Tcl Result:
+ *    A list of the current generation, the list of the numbers of the
+ *    points of KIND deleted after SINCE, the list of the numbers of the
+ *    points, and then one list for each field of the info command for
+ *    KIND, with one element per point.  The deleted list is "all" when
+ *    SINCE is missing or too old to tell: all the points are returned,
+ *    and those the caller knows and which are not returned are gone.
+ */
+static int
+gdb_get_point_info (ClientData clientData, Tcl_Interp *interp,
+		    int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *kind_names[] =
+    {"breakpoints", "tracepoints", "watchpoints", NULL};
+  static const struct
+  {
+    char kind;
+    int (*is_type) (const struct breakpoint *);
+    void (*get_info) (Tcl_Interp *, struct breakpoint *, Tcl_Obj *);
+  } kinds[] =
+    {
+      { 'b', is_breakpoint, get_breakpoint_info },
+      { 't', is_tracepoint, get_tracepoint_info },
+      { 'w', is_watchpoint, get_watchpoint_info }
+    };
+  std::vector<Tcl_Obj *> columns;
+  Tcl_Obj *numbers, *deleted;
+  Tcl_WideInt since = 0;
+  struct breakpoint *b;
+  int kind;
+  bool in_file = false;
+  std::set<int> file_points;
+
+  if (objc > 2 && !strcmp (Tcl_GetStringFromObj (objv[1], NULL), "-file"))
+    {
+      struct symtab *s = lookup_symtab (Tcl_GetStringFromObj (objv[2],
+							      NULL));
+
+      if (s != NULL)
+	{
+	  auto file = bp_index_by_line.find (s->filename);
+
+	  if (file != bp_index_by_line.end ())
+	    for (const auto &line : file->second)
+	      file_points.insert (line.second.begin (), line.second.end ());
+	}
+      in_file = true;
+      objc -= 2;
+      objv += 2;
+    }
+
+  if (objc != 2 && objc != 3)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "?-file filename? kind ?since?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], kind_names, "kind", 0,
+			   &kind) != TCL_OK
+      || (objc == 3
+	  && Tcl_GetWideIntFromObj (interp, objv[2], &since) != TCL_OK))
+    {
+      result_ptr->flags = GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  if (since < (Tcl_WideInt) bp_deletions_start - 1 || since < 0)
+    since = 0;
+
+  if (since == 0)
+    deleted = Tcl_NewStringObj ("all", -1);
+  else
+    {
+      deleted = Tcl_NewListObj (0, NULL);
+      for (const bp_deletion &deletion : bp_deletions)
+	if (deletion.generation > (unsigned long) since
+	    && deletion.kind == kinds[kind].kind)
+	  Tcl_ListObjAppendElement (NULL, deleted,
+				    Tcl_NewIntObj (deletion.number));
+    }
+
+  numbers = Tcl_NewListObj (0, NULL);
+  ALL_BREAKPOINTS (b)
+    {
+      Tcl_Obj *info, **fields;
+      int nfields, i;
+
+      if (!kinds[kind].is_type (b)
+	  || (in_file && file_points.find (b->number) == file_points.end ()))
+	continue;
+
+      /* Points missing from the index have no generation: always
+	 return them.  */
+      if (since != 0)
+	{
+	  auto it = bp_index.find (b->number);
+
+	  if (it != bp_index.end ()
+	      && it->second.generation <= (unsigned long) since)
+	    continue;
+	}
+
+      info = Tcl_NewListObj (0, NULL);
+      Tcl_IncrRefCount (info);
+      kinds[kind].get_info (interp, b, info);
+      Tcl_ListObjGetElements (NULL, info, &nfields, &fields);
+      for (i = 0; i < nfields; i++)
+	{
+	  if ((size_t) i == columns.size ())
+	    columns.push_back (Tcl_NewListObj (0, NULL));
+	  Tcl_ListObjAppendElement (NULL, columns[i], fields[i]);
+	}
+      Tcl_DecrRefCount (info);
+
+      Tcl_ListObjAppendElement (NULL, numbers, Tcl_NewIntObj (b->number));
+    }
+
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+			    Tcl_NewWideIntObj (bp_generation));
+  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, deleted);
+  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, numbers);
+  for (Tcl_Obj *column : columns)
+    Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, column);
+
+  return TCL_OK;
+}
+
 /* This implements the tcl command "gdb_set_bp"
  * It sets breakpoints, and notifies the GUI.
  *
@@ -524,7 +895,8 @@ gdb_get_breakpoint_list (ClientData clientData, Tcl_Interp *interp,
  *    type:     the type of the breakpoint
  *    thread:   optional thread number
  * Tcl Result:
- *    The return value of the call to gdbtk_tcl_breakpoint.
+ *    None.  The windows hear of the new breakpoint through
+ *    gdbtk_tcl_breakpoints.
  */
 static int
 gdb_set_bp (ClientData clientData, Tcl_Interp *interp,
@@ -615,6 +987,8 @@ gdbtk_create_breakpoint (struct breakpoint *b)
   if (b == NULL || !BREAKPOINT_IS_INTERESTING (b))
     return;
 
+  bp_index_add (b);
+
   breakpoint_notify (b->number, "create");
 }
 
@@ -622,13 +996,17 @@ void
 gdbtk_delete_breakpoint (struct breakpoint *b)
 {
   breakpoint_notify (b->number, "delete");
+  bp_index_delete (b->number);
 }
 
 void
 gdbtk_modify_breakpoint (struct breakpoint *b)
 {
   if (b->number >= 0)
-    breakpoint_notify (b->number, "modify");
+    {
+      bp_index_add (b);
+      breakpoint_notify (b->number, "modify");
+    }
 }
 
 void
@@ -641,17 +1019,44 @@ gdbtk_delete_all_breakpoints (void)
       delete_breakpoint (b);
 }
 
+/* The breakpoint changes not handed to the GUI yet, in order.  A
+   deleted point is gone by the time they are, so its info is taken
+   when it is deleted; the others get their info when handed over.
+   A change superseded by a later one has a NULL action.  */
+struct bp_change
+{
+  const char *kind;
+  void (*get_info) (Tcl_Interp *, struct breakpoint *, Tcl_Obj *);
+  const char *action;
+  int number;
+  Tcl_Obj *data;
+};
+
+static std::vector<bp_change> bp_changes;
+
+/* The index in bp_changes of the live change of each point.  */
+static std::unordered_map<int, size_t> bp_change_index;
+static bool bp_changes_queued = false;
+
+static void
+gdbtk_breakpoints_idle (ClientData clientData)
+{
+  bp_changes_queued = false;
+  gdbtk_flush_breakpoints ();
+}
+
 /* This is the generic function for handling changes in
- * a breakpoint.  It routes the information to the Tcl
- * command "gdbtk_tcl_breakpoint" (or "gdbtk_tcl_tracepoint") in the form:
- *   gdbtk_tcl_breakpoint action b_number b_address b_line b_file
- * On error, the error string is written to gdb_stdout.
+ * a breakpoint.  It queues the change, which is handed to the Tcl
+ * command "gdbtk_tcl_breakpoints" along with all the others of the
+ * same command (see gdbtk_flush_breakpoints).  A point modified
+ * several times is reported once, and a point created and deleted
+ * before the GUI heard of it is not reported at all.
  */
 static void
 breakpoint_notify (int num, const char *action)
 {
-  std::string buf;
   struct breakpoint *b;
+  bp_change change;
 
   b = get_breakpoint (num);
   if (b == NULL)
@@ -660,33 +1065,147 @@ breakpoint_notify (int num, const char *action)
   if (b->number < 0)
     return;
 
-  /* We ensure that ACTION contains no special Tcl characters, so we
-     can do this.  */
   switch (b->type)
     {
     case bp_breakpoint:
     case bp_hardware_breakpoint:
-      buf = string_printf ("gdbtk_tcl_breakpoint %s %d", action, b->number);
+      change.kind = "breakpoint";
+      change.get_info = get_breakpoint_info;
       break;
     case bp_tracepoint:
     case bp_fast_tracepoint:
     case bp_static_tracepoint:
-      buf = string_printf ("gdbtk_tcl_tracepoint %s %d", action, b->number);
+      change.kind = "tracepoint";
+      change.get_info = get_tracepoint_info;
       break;
     case bp_watchpoint:
     case bp_hardware_watchpoint:
     case bp_read_watchpoint:
     case bp_access_watchpoint:
-      buf = string_printf ("gdbtk_tcl_watchpoint %s %d", action, b->number);
+      change.kind = "watchpoint";
+      change.get_info = get_watchpoint_info;
       break;
     default:
       return;
     }
 
-  if (Tcl_Eval (gdbtk_get_interp ()->tcl, buf.c_str ()) != TCL_OK)
+  auto it = bp_change_index.find (num);
+  if (it != bp_change_index.end ())
+    {
+      bp_change &last = bp_changes[it->second];
+
+      /* The pending create or modify takes the new info anyway.  */
+      if (strcmp (action, "modify") == 0)
+	return;
+
+      if (strcmp (action, "delete") == 0)
+	{
+	  bool created = strcmp (last.action, "create") == 0;
+
+	  last.action = NULL;
+	  bp_change_index.erase (it);
+	  if (created)
+	    return;
+	}
+    }
+
+  change.action = action;
+  change.number = num;
+  change.data = NULL;
+  if (strcmp (action, "delete") == 0)
+    {
+      change.data = Tcl_NewListObj (0, NULL);
+      Tcl_IncrRefCount (change.data);
+      change.get_info (gdbtk_get_interp ()->tcl, b, change.data);
+    }
+
+  bp_change_index[num] = bp_changes.size ();
+  bp_changes.push_back (change);
+
+  if (!bp_changes_queued)
+    {
+      bp_changes_queued = true;
+      Tcl_DoWhenIdle (gdbtk_breakpoints_idle, NULL);
+    }
+}
+
+/* Hand the queued breakpoint changes to the GUI, as a single call
+ *   gdbtk_tcl_breakpoints {kind action number info ...}
+ * On error, the error string is written to gdb_stdout.
+ */
+void
+gdbtk_flush_breakpoints (void)
+{
+  std::vector<bp_change> changes;
+  Tcl_Obj *objv[2], *saved;
+  Tcl_Interp *tcl = gdbtk_get_interp ()->tcl;
+
+  if (bp_changes.empty ())
+    return;
+
+  /* The Tcl code may change breakpoints in turn.  */
+  changes.swap (bp_changes);
+  bp_change_index.clear ();
+
+  objv[0] = Tcl_NewStringObj ("gdbtk_tcl_breakpoints", -1);
+  objv[1] = Tcl_NewListObj (0, NULL);
+  Tcl_IncrRefCount (objv[0]);
+  Tcl_IncrRefCount (objv[1]);
+
+  for (bp_change &change : changes)
+    {
+      if (change.action != NULL && change.data == NULL)
+	{
+	  struct breakpoint *b = get_breakpoint (change.number);
+
+	  if (b == NULL)
+	    continue;
+	  change.data = Tcl_NewListObj (0, NULL);
+	  Tcl_IncrRefCount (change.data);
+	  change.get_info (tcl, b, change.data);
+	}
+
+      if (change.action != NULL)
+	{
+	  Tcl_ListObjAppendElement (NULL, objv[1],
+				    Tcl_NewStringObj (change.kind, -1));
+	  Tcl_ListObjAppendElement (NULL, objv[1],
+				    Tcl_NewStringObj (change.action, -1));
+	  Tcl_ListObjAppendElement (NULL, objv[1],
+				    Tcl_NewIntObj (change.number));
+	  Tcl_ListObjAppendElement (NULL, objv[1], change.data);
+	}
+
+      if (change.data != NULL)
+	Tcl_DecrRefCount (change.data);
+    }
+
+  /* All the changes may have cancelled out.  */
+  int length = 0;
+  Tcl_ListObjLength (NULL, objv[1], &length);
+  if (length == 0)
+    {
+      Tcl_DecrRefCount (objv[0]);
+      Tcl_DecrRefCount (objv[1]);
+      return;
+    }
+
+  /* We may be called with the result of a command already in place.  */
+  saved = Tcl_GetObjResult (tcl);
+  Tcl_IncrRefCount (saved);
+
+  gdbtk_flush_output ();
+  if (Tcl_EvalObjv (tcl, 2, objv, TCL_EVAL_GLOBAL) != TCL_OK)
     report_error ();
+
+  Tcl_SetObjResult (tcl, saved);
+  Tcl_DecrRefCount (saved);
+  Tcl_DecrRefCount (objv[0]);
+  Tcl_DecrRefCount (objv[1]);
+
+  gdbtk_schedule_update (GDBTK_UPDATE_BREAKPOINTS);
 }
-
+
 /*
  * This section contains the commands that deal with tracepoints.
  */
@@ -786,12 +1305,8 @@ static int
 gdb_get_tracepoint_info (ClientData clientData, Tcl_Interp *interp,
 			 int objc, Tcl_Obj *CONST objv[])
 {
-  struct symtab_and_line sal;
   int tpnum;
   struct tracepoint *tp;
-  struct breakpoint *bp;
-  Tcl_Obj *action_list;
-  const char *filename, *funcname;
 
   if (objc != 2)
     {
@@ -806,7 +1321,6 @@ gdb_get_tracepoint_info (ClientData clientData, Tcl_Interp *interp,
     }
 
   tp = get_tracepoint (tpnum);
-  bp = (struct breakpoint *) tp;
   if (tp == NULL)
     {
       gdbtk_set_result (interp, "Tracepoint #%d does not exist", tpnum);
@@ -814,41 +1328,54 @@ gdb_get_tracepoint_info (ClientData clientData, Tcl_Interp *interp,
     }
 
   Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  get_tracepoint_info (interp, (struct breakpoint *) tp,
+		       result_ptr->obj_ptr);
+  return TCL_OK;
+}
+
+/* Append the fields of gdb_get_tracepoint_info for BP to LIST.  */
+
+static void
+get_tracepoint_info (Tcl_Interp *interp, struct breakpoint *bp, Tcl_Obj *list)
+{
+  struct symtab_and_line sal;
+  struct tracepoint *tp = (struct tracepoint *) bp;
+  Tcl_Obj *action_list;
+  const char *filename, *funcname;
+
   sal = find_pc_line (bp->loc->address, 0);
   filename = symtab_to_filename (sal.symtab);
   if (filename == NULL)
     filename = "N/A";
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewStringObj (filename, -1));
 
   funcname = pc_function_name (bp->loc->address);
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr, Tcl_NewStringObj
+  Tcl_ListObjAppendElement (interp, list, Tcl_NewStringObj
 			    (funcname, -1));
 
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (sal.line));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewStringObj (core_addr_to_string (bp->loc->address), -1));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (bp->enable_state == bp_enabled));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (tp->pass_count));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (tp->step_count));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (bp->thread));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewIntObj (bp->hit_count));
 
   /* Append a list of actions */
   action_list = Tcl_NewObj ();
   if (bp->commands)
     gdb_get_action_list (interp, action_list, breakpoint_commands (bp));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr, action_list);
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list, action_list);
+  Tcl_ListObjAppendElement (interp, list,
 			    Tcl_NewStringObj (bp->cond_string, -1));
-
-  return TCL_OK;
 }
 
 /* return a list of all tracepoint numbers in interpreter */
@@ -958,10 +1485,6 @@ gdb_get_watchpoint_info (ClientData clientData, Tcl_Interp *interp,
 			 int objc, Tcl_Obj *CONST objv[])
 {
   int wpnum;
-  int mask;
-  std::string frame;
-  struct frame_info *finfo;
-  struct watchpoint *wp;
   struct breakpoint *bp;
 
   if (objc != 2)
@@ -983,7 +1506,21 @@ gdb_get_watchpoint_info (ClientData clientData, Tcl_Interp *interp,
       return TCL_ERROR;
     }
 
-  wp = (struct watchpoint *) bp;
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  get_watchpoint_info (interp, bp, result_ptr->obj_ptr);
+  return TCL_OK;
+}
+
+/* Append the fields of gdb_get_watchpoint_info for BP to LIST.  */
+
+static void
+get_watchpoint_info (Tcl_Interp *interp, struct breakpoint *bp, Tcl_Obj *list)
+{
+  int mask;
+  std::string frame;
+  struct frame_info *finfo;
+  struct watchpoint *wp = (struct watchpoint *) bp;
+
   mask = wp->hw_wp_mask;
   if (bp->type != bp_hardware_breakpoint || !mask ||
       !have_masked_watchpoints ())
@@ -998,31 +1535,28 @@ gdb_get_watchpoint_info (ClientData clientData, Tcl_Interp *interp,
         frame = print_core_address (get_current_arch (), frm);
     }
 
-  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
                             Tcl_NewStringObj (core_addr_to_string
                                                        (bp->loc->address), -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (bptypes[bp->type], -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewBooleanObj (bp->enable_state == bp_enabled));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (bp->ignore_count));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    get_breakpoint_commands (breakpoint_commands (bp)));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (bp->cond_string, -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (bp->thread));
-  Tcl_ListObjAppendElement (interp, result_ptr->obj_ptr, Tcl_NewIntObj (mask));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (interp, list, Tcl_NewIntObj (mask));
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewIntObj (bp->hit_count));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
 			    Tcl_NewStringObj (wp->exp_string, -1));
-  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+  Tcl_ListObjAppendElement (NULL, list,
                             Tcl_NewStringObj (frame.c_str (), -1));
-
-  return TCL_OK;
 }
 
 /* This implements the tcl command gdb_get_watchpoint_list
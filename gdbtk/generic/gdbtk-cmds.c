@@ -51,6 +51,10 @@
 #include "psymtab.h"
 #include <ctype.h>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 /* tcl header files includes varargs.h unless HAS_STDARG is defined,
    but gdb uses stdarg.h, so make sure HAS_STDARG is defined.  */
@@ -71,6 +75,17 @@
 #endif
 #include <sys/time.h>
 #include <sys/stat.h>
+/* HAVE_MMAP comes from the AC_FUNC_MMAP check of gdb's configure, as
+   for gdb_bfd.c.  */
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void *) -1)
+#endif
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 #include <string.h>
 #include "dis-asm.h"
@@ -144,6 +159,147 @@ struct disassembly_client_data
   Tcl_DString pc_to_line_prefix;
   Tcl_DString line_to_pc_prefix;
   Tcl_CmdInfo cmd;
+  struct disassembly_cache_entry *record;
+  struct gdbtk_asm_index *index;
+};
+
+/* The index of the lines of a disassembly text widget, filled by
+   gdb_load_disassembly and queried by binary search.  It is installed
+   as a Tcl object command by gdb_asm_index.  */
+
+struct gdbtk_asm_index
+{
+  void clear ()
+  {
+    line_to_pc.clear ();
+    pc_to_line.clear ();
+    src_to_line.clear ();
+    sorted = true;
+  }
+
+  void sort ();
+
+  /* Instruction lines, in widget line order.  */
+  std::vector<std::pair<int, CORE_ADDR>> line_to_pc;
+
+  /* Instruction and source lines, sorted by address and source line
+     number when SORTED.  The last line wins for duplicate keys.  */
+  std::vector<std::pair<CORE_ADDR, int>> pc_to_line;
+  std::vector<std::pair<int, int>> src_to_line;
+  bool sorted = true;
+};
+
+/* A line of the disassembly text widget, as recorded in the disassembly
+   cache.  Source lines have a SOURCE_LINE and TEXT[0] only, instruction
+   lines have a PC and the address, symbolic offset and code texts.  */
+
+struct disassembly_line
+{
+  CORE_ADDR pc;
+  int source_line;
+  std::string text[3];
+};
+
+/* The disassembly of a range, as loaded by gdb_load_disassembly.  The
+   entry is COMPLETE once the whole range was recorded.  */
+
+struct disassembly_cache_entry
+{
+  std::vector<disassembly_line> lines;
+  bool complete = false;
+
+  /* The range disassembled.  */
+  CORE_ADDR low = 0, high = 0;
+};
+
+/* Maximum number of ranges held in the disassembly cache.  The cache is
+   flushed when full.  */
+
+#define GDBTK_DISASSEMBLY_CACHE_SIZE 64
+
+/* The disassembly cache, indexed by disassembly_cache_key.  */
+
+static std::unordered_map<std::string, disassembly_cache_entry>
+  disassembly_cache;
+
+/* Position of an incremental disassembly, so that gdb_disassemble_driver
+   can print a range in several chunks.  */
+
+struct disassembly_cursor
+{
+  int limit;			/* Instructions to print in this chunk,
+				   0 if unlimited. */
+  CORE_ADDR through;		/* Don't stop before passing this address. */
+  int printed;			/* Instructions printed so far. */
+  int started;			/* Set once PC, ENTRY and NEXT_LINE are valid. */
+  int done;			/* Set when the whole range is printed. */
+  CORE_ADDR pc;			/* Next instruction to print. */
+  int entry;			/* Line entry of PC, in mixed mode. */
+  int next_line;		/* Next source line to print, in mixed mode. */
+};
+
+/* Memory is cached by aligned pages of this many bytes.  Keep it small:
+   over a slow serial link, every byte counts.  */
+
+#define GDBTK_MEM_PAGE_SIZE 256
+
+/* Maximum number of pages held in the memory cache.  The cache is simply
+   flushed when full.  */
+
+#define GDBTK_MEM_CACHE_PAGES 4096
+
+/* Maximum number of missing pages fetched by a single target read.  */
+
+#define GDBTK_MEM_FILL_PAGES 16
+
+/* A cache of target memory pages, shared by all the windows, so that
+   memory is read from the target only once per stop, and by blocks
+   rather than by cells.  It is flushed or invalidated by the hooks
+   whenever the target memory may have changed, see gdbtk-hooks.c.  */
+
+class gdbtk_mem_cache
+{
+public:
+  int read (CORE_ADDR addr, gdb_byte *buf, int len);
+  void write (CORE_ADDR addr, const gdb_byte *buf, int len);
+  void invalidate (CORE_ADDR addr, LONGEST len);
+
+  void flush ()
+  {
+    m_pages.clear ();
+  }
+
+private:
+  struct page
+  {
+    int len;			/* Number of valid bytes from page start. */
+    gdb_byte data[GDBTK_MEM_PAGE_SIZE];
+  };
+
+  void fill (CORE_ADDR base, int npages);
+
+  std::unordered_map<CORE_ADDR, std::unique_ptr<page>> m_pages;
+};
+
+static gdbtk_mem_cache memory_cache;
+
+/* A memory view is the native cell provider of a memory window table.
+   It is installed as a Tcl object command by gdb_memview.  */
+
+struct gdbtk_memview
+{
+  CORE_ADDR addr = 0;		/* Address of the first cell. */
+  int nbytes = 0;		/* Size of the dump, 0 if unbounded. */
+  char format = 'x';		/* Cell format. */
+  int size = 1;			/* Cell size in bytes. */
+  int bpr = 16;			/* Bytes per row. */
+  char aschar = 0;		/* Unprintable char, 0 if no ASCII column. */
+
+  /* Contents of the rows the table has fetched since the last
+     refresh, by row number.  Only the readable prefix of each row is
+     kept.  These are the rows the table has cached, and so the only
+     ones "changes" needs to look at.  */
+  std::map<int, std::vector<gdb_byte>> rows;
 };
 
 /* This variable determines where memory used for disassembly is read
@@ -182,6 +338,18 @@ static int gdb_get_function_command (ClientData, Tcl_Interp *, int,
 static int gdb_get_line_command (ClientData, Tcl_Interp *, int,
 				 Tcl_Obj * CONST objv[]);
 static int gdb_update_mem (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int gdb_update_mem_binary (Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int gdb_format_mem (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int gdb_memview (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int memview_obj_command (ClientData, Tcl_Interp *, int,
+				Tcl_Obj * CONST[]);
+static void memview_delete (ClientData);
+static int memview_configure (Tcl_Interp *, struct gdbtk_memview *,
+			      int, Tcl_Obj * CONST[]);
+static Tcl_Obj *memview_cell (struct gdbtk_memview *, int, int);
+static void memview_read_row (struct gdbtk_memview *, int,
+			      std::vector<gdb_byte> *);
+static Tcl_Obj *memview_changes (struct gdbtk_memview *);
 static int gdb_set_mem (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static int gdb_immediate_command (ClientData, Tcl_Interp *, int,
 				  Tcl_Obj * CONST[]);
@@ -191,6 +359,12 @@ static int gdb_listfiles (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static int gdb_listfuncs (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static int gdb_loadfile (ClientData, Tcl_Interp *, int,
 			 Tcl_Obj * CONST objv[]);
+static int gdb_source (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int gdb_executable_lines (ClientData, Tcl_Interp *, int,
+				 Tcl_Obj * CONST[]);
+static int source_obj_command (ClientData, Tcl_Interp *, int,
+			       Tcl_Obj * CONST[]);
+static void source_delete (ClientData);
 static int gdb_load_disassembly (ClientData clientData, Tcl_Interp
 				 * interp, int objc, Tcl_Obj * CONST objv[]);
 static int gdb_get_inferior_args (ClientData clientData,
@@ -208,15 +382,29 @@ static int gdb_prompt_command (ClientData, Tcl_Interp *, int,
 static int gdb_restore_write (ClientData, Tcl_Interp *, int,
 			      Tcl_Obj * CONST[]);
 static int gdb_search (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST objv[]);
+static int gdb_search_functions (ClientData, Tcl_Interp *, int,
+				 Tcl_Obj * CONST objv[]);
 static int gdb_stop (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static int gdb_target_has_execution_command (ClientData,
 					     Tcl_Interp *, int,
 					     Tcl_Obj * CONST[]);
+static int gdb_dirty (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int gdb_console (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static void gdbtk_load_source (ClientData clientData,
 			       struct symtab *symtab,
 			       int start_line, int end_line);
 static CORE_ADDR gdbtk_load_asm (ClientData clientData, CORE_ADDR pc,
 				 struct disassemble_info *di);
+static void gdbtk_emit_source_line (struct disassembly_client_data *,
+				    int, const char *);
+static void gdbtk_emit_asm_line (struct disassembly_client_data *,
+				 CORE_ADDR, const char *, const char *,
+				 const char *);
+static std::string disassembly_cache_key (CORE_ADDR, CORE_ADDR, int);
+static int gdb_asm_index (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
+static int asm_index_obj_command (ClientData, Tcl_Interp *, int,
+				  Tcl_Obj * CONST[]);
+static void asm_index_delete (ClientData);
 static int gdb_disassemble_driver (CORE_ADDR low, CORE_ADDR high,
 				   int mixed_source_and_assembly,
 				   ClientData clientData,
@@ -227,10 +415,16 @@ static int gdb_disassemble_driver (CORE_ADDR low, CORE_ADDR high,
 							      CORE_ADDR,
 							      struct
 							      disassemble_info
-							      *));
+							      *),
+				   struct disassembly_cursor *cursor);
 static int perror_with_name_wrapper (PTR args);
 static int hex2bin (const char *hex, char *bin, int count);
 static int fromhex (int a);
+static struct type *memory_cell_type (int size, char *asize);
+static void format_memory_cell (const gdb_byte *data, struct type *val_type,
+				char asize, char format, string_file *stb);
+static int format_memory_ascii (const gdb_byte *data, int count,
+				char aschar, char *buf);
 static int gdb_list_processes (ClientData,
                                Tcl_Interp *,
                                int,
@@ -267,6 +461,10 @@ Gdbtk_Init (Tcl_Interp *interp)
 			(ClientData) gdb_entry_point, NULL);
   Tcl_CreateObjCommand (interp, "gdb_update_mem", gdbtk_call_wrapper,
 			(ClientData) gdb_update_mem, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_format_mem", gdbtk_call_wrapper,
+			(ClientData) gdb_format_mem, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_memview", gdbtk_call_wrapper,
+			(ClientData) gdb_memview, NULL);
   Tcl_CreateObjCommand (interp, "gdb_set_mem", gdbtk_call_wrapper,
 			(ClientData) gdb_set_mem, NULL);
   Tcl_CreateObjCommand (interp, "gdb_stop", gdbtk_call_wrapper,
@@ -287,6 +485,10 @@ Gdbtk_Init (Tcl_Interp *interp)
 			(ClientData) gdb_force_quit, NULL);
   Tcl_CreateObjCommand (interp, "gdb_target_has_execution", gdbtk_call_wrapper,
 			(ClientData) gdb_target_has_execution_command, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_dirty", gdbtk_call_wrapper,
+			(ClientData) gdb_dirty, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_console", gdbtk_call_wrapper,
+			(ClientData) gdb_console, NULL);
   Tcl_CreateObjCommand (interp, "gdb_load_info", gdbtk_call_wrapper,
 			(ClientData) gdb_load_info, NULL);
   Tcl_CreateObjCommand (interp, "gdb_get_function", gdbtk_call_wrapper,
@@ -301,10 +503,18 @@ Gdbtk_Init (Tcl_Interp *interp)
 			(ClientData) gdb_find_file_command, NULL);
   Tcl_CreateObjCommand (interp, "gdb_loadfile", gdbtk_call_wrapper,
 			(ClientData) gdb_loadfile, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_source", gdbtk_call_wrapper,
+			(ClientData) gdb_source, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_executable_lines", gdbtk_call_wrapper,
+			(ClientData) gdb_executable_lines, NULL);
   Tcl_CreateObjCommand (interp, "gdb_load_disassembly", gdbtk_call_wrapper,
 			(ClientData) gdb_load_disassembly,  NULL);
+  Tcl_CreateObjCommand (interp, "gdb_asm_index", gdbtk_call_wrapper,
+			(ClientData) gdb_asm_index,  NULL);
   Tcl_CreateObjCommand (interp, "gdb_search", gdbtk_call_wrapper,
 			(ClientData) gdb_search, NULL);
+  Tcl_CreateObjCommand (interp, "gdb_search_functions", gdbtk_call_wrapper,
+			(ClientData) gdb_search_functions, NULL);
   Tcl_CreateObjCommand (interp, "gdb_get_inferior_args", gdbtk_call_wrapper,
 			(ClientData) gdb_get_inferior_args, NULL);
   Tcl_CreateObjCommand (interp, "gdb_set_inferior_args", gdbtk_call_wrapper,
@@ -349,6 +559,14 @@ Gdbtk_Init (Tcl_Interp *interp)
   if (Gdbtk_Register_Init (interp) != TCL_OK)
     return TCL_ERROR;
 
+  /* How to keep the GUI alive while the inferior runs */
+  Tcl_LinkVar (interp, "gdbtk_event_driven",
+	       (char *) &gdbtk_event_driven,
+	       TCL_LINK_INT);
+  Tcl_LinkVar (interp, "gdbtk_max_redraw_rate",
+	       (char *) &gdbtk_max_redraw_rate,
+	       TCL_LINK_INT);
+
   /* Determine where to disassemble from */
   Tcl_LinkVar (interp, "disassemble-from-exec",
 	       (char *) &disassemble_from_exec,
@@ -409,12 +627,18 @@ gdbtk_call_wrapper (ClientData clientData, Tcl_Interp *interp,
          the command routine.  */
 
       running_now = 0;
+      gdbtk_flush_output ();
       Tcl_Eval (interp, "gdbtk_tcl_idle");
     }
 
   /* do not suppress any errors -- a remote target could have errored */
   load_in_progress = 0;
 
+  /* Hand any output and breakpoint changes the command batched up
+     to the windows.  */
+  gdbtk_flush_output ();
+  gdbtk_flush_breakpoints ();
+
   /*
    * Now copy the result over to the true Tcl result.  If
    * GDBTK_TO_RESULT flag bit is set, this just copies a null object
@@ -859,6 +1083,463 @@ gdb_target_has_execution_command (ClientData clientData, Tcl_Interp *interp,
   return TCL_OK;
 }
 
+/* This implements the tcl command "gdb_dirty"
+
+* Tells what changed in the target since the windows were last
+* updated, and forgets it.
+*
+* Tcl Arguments:
+*    None
+* Tcl Result:
+*    A list of two elements: the list of the changed categories
+*    ("registers", "memory", "breakpoints" and "context"), and the
+*    list of the {start end} address ranges of the memory written,
+*    end excluded.  The latter is empty if "memory" is not changed,
+*    or if the ranges are unknown.
+*/
+
+static int
+gdb_dirty (ClientData clientData, Tcl_Interp *interp,
+	   int objc, Tcl_Obj *CONST objv[])
+{
+  static const struct
+  {
+    int flag;
+    const char *name;
+  } categories[] =
+    {
+      { GDBTK_UPDATE_REGISTERS, "registers" },
+      { GDBTK_UPDATE_MEMORY, "memory" },
+      { GDBTK_UPDATE_BREAKPOINTS, "breakpoints" },
+      { GDBTK_UPDATE_CONTEXT, "context" }
+    };
+  std::vector<std::pair<CORE_ADDR, CORE_ADDR>> ranges;
+  Tcl_Obj *changed, *written;
+  int dirty;
+
+  if (objc != 1)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, NULL);
+      return TCL_ERROR;
+    }
+
+  dirty = gdbtk_take_dirty (&ranges);
+
+  changed = Tcl_NewListObj (0, NULL);
+  for (const auto &category : categories)
+    if (dirty & category.flag)
+      Tcl_ListObjAppendElement (NULL, changed,
+				Tcl_NewStringObj (category.name, -1));
+
+  written = Tcl_NewListObj (0, NULL);
+  for (const auto &range : ranges)
+    {
+      Tcl_Obj *elems[2];
+
+      elems[0] = Tcl_NewStringObj (core_addr_to_string (range.first), -1);
+      elems[1] = Tcl_NewStringObj (core_addr_to_string (range.second), -1);
+      Tcl_ListObjAppendElement (NULL, written, Tcl_NewListObj (2, elems));
+    }
+
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, changed);
+  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, written);
+  return TCL_OK;
+}
+
+/* The text shown by the console window, kept here so that it outlives
+   the window and can be searched beyond the lines the window keeps.
+   The text is split in lines; the last one is not ended yet.  */
+
+struct gdbtk_console_line
+{
+  std::string text;
+
+  /* Tag of the text, or of its first run if it has several.  */
+  unsigned char tag = 0;
+
+  /* Offset in TEXT and tag of each run after the first.  */
+  std::vector<std::pair<unsigned int, unsigned char>> runs;
+};
+
+struct gdbtk_console_log
+{
+  void append (const char *tag, const char *text, size_t len);
+  void fill (std::vector<const char *> &argv, std::string &buf,
+	     int first, int last) const;
+  int find (const char *string, int line, bool forwards) const;
+  void trim ();
+
+  int last () const
+  {
+    return first + lines.size () - 1;
+  }
+
+  /* There is always a last line, which the text is appended to.  */
+  std::deque<gdbtk_console_line> lines = std::deque<gdbtk_console_line> (1);
+
+  /* Number of the first line kept; lines are numbered from 1.  */
+  int first = 1;
+
+  /* Whether the next text appended starts a new line.  */
+  bool need_nl = false;
+
+  /* Size of the text kept.  */
+  size_t bytes = 0;
+
+  /* How much text to keep.  */
+  size_t max_lines = 20000;
+  size_t max_bytes = 4 * 1024 * 1024;
+
+  /* The names of the tags, indexed by the tag numbers of the lines.  */
+  std::vector<std::string> tags { "" };
+};
+
+static gdbtk_console_log console_log;
+
+/* Append the LEN bytes of TEXT with TAG to the log.  */
+
+void
+gdbtk_console_log::append (const char *tag, const char *text, size_t len)
+{
+  unsigned char t;
+
+  if (need_nl)
+    {
+      lines.emplace_back ();
+      bytes++;
+      need_nl = false;
+    }
+
+  if (len == 0)
+    {
+      trim ();
+      return;
+    }
+
+  auto it = std::find (tags.begin (), tags.end (), tag);
+  if (it != tags.end ())
+    t = it - tags.begin ();
+  else if (tags.size () < 256)
+    {
+      t = tags.size ();
+      tags.push_back (tag);
+    }
+  else
+    t = 0;
+
+  while (true)
+    {
+      const char *eol = (const char *) memchr (text, '\n', len);
+      size_t n = eol != NULL ? eol - text : len;
+      gdbtk_console_line &line = lines.back ();
+
+      if (n > 0)
+	{
+	  if (line.text.empty ())
+	    line.tag = t;
+	  else if (t != (line.runs.empty () ? line.tag
+			 : line.runs.back ().second))
+	    line.runs.emplace_back (line.text.size (), t);
+	  line.text.append (text, n);
+	  bytes += n;
+	}
+
+      if (eol == NULL)
+	break;
+
+      lines.emplace_back ();
+      bytes++;
+      text += n + 1;
+      len -= n + 1;
+    }
+
+  trim ();
+}
+
+/* Drop the oldest lines beyond the limits.  The last line is kept.  */
+
+void
+gdbtk_console_log::trim ()
+{
+  while (lines.size () > 1
+	 && (lines.size () > max_lines || bytes > max_bytes))
+    {
+      bytes -= lines.front ().text.size () + 1;
+      lines.pop_front ();
+      first++;
+    }
+}
+
+/* Append to ARGV the text and tag list pairs of lines FIRST to LAST,
+   each one followed by a newline, for the insert command of a text
+   widget.  The strings are kept in BUF, which must not be changed
+   afterwards.  */
+
+void
+gdbtk_console_log::fill (std::vector<const char *> &argv, std::string &buf,
+			 int first, int last) const
+{
+  std::vector<std::pair<size_t, unsigned char>> runs;
+  int ln;
+
+  for (ln = first; ln <= last; ln++)
+    {
+      const gdbtk_console_line &line = lines[ln - this->first];
+      unsigned int start = 0;
+      unsigned char tag = line.tag;
+
+      for (size_t i = 0; i <= line.runs.size (); i++)
+	{
+	  unsigned int end = (i < line.runs.size () ? line.runs[i].first
+			      : line.text.size ());
+
+	  runs.emplace_back (buf.size (), tag);
+	  buf.append (line.text, start, end - start);
+	  if (i == line.runs.size ())
+	    buf += '\n';
+	  buf += '\0';
+
+	  if (i < line.runs.size ())
+	    {
+	      start = end;
+	      tag = line.runs[i].second;
+	    }
+	}
+    }
+
+  for (const auto &run : runs)
+    {
+      argv.push_back (buf.c_str () + run.first);
+      argv.push_back (tags[run.second].c_str ());
+    }
+}
+
+/* Return the number of the nearest line at or after LINE (or before it
+   if not FORWARDS) containing STRING, or 0 if there is none.  */
+
+int
+gdbtk_console_log::find (const char *string, int line, bool forwards) const
+{
+  if (*string == '\0')
+    return 0;
+
+  line = std::max (first, std::min (line, last ()));
+  for (; line >= first && line <= last (); line += forwards ? 1 : -1)
+    if (lines[line - first].text.find (string) != std::string::npos)
+      return line;
+
+  return 0;
+}
+
+/* Append the LEN bytes of TEXT with TAG to the console log, without
+   their carriage returns.  The output of gdb gets there this way,
+   whether or not a console window shows it.  */
+
+void
+gdbtk_console_log_append (const char *tag, const char *text, size_t len)
+{
+  if (memchr (text, '\r', len) == NULL)
+    {
+      console_log.append (tag, text, len);
+      return;
+    }
+
+  std::string buf (text, len);
+
+  buf.erase (std::remove (buf.begin (), buf.end (), '\r'), buf.end ());
+  console_log.append (tag, buf.data (), buf.size ());
+}
+
+/* This implements the tcl command "gdb_console"
+
+* Keeps the text shown in the console window.  The output of gdb is
+* appended by gdbtk_flush_output, the window only adds what it
+* shows itself (commands, Tcl messages...).
+*
+* Tcl Arguments:
+*    option - One of:
+*      append TAG TEXT
+*        Append TEXT, shown with the text widget tag TAG.
+*      newline
+*        Start a new line with the next text appended, once.
+*      range
+*        Return the numbers of the first and last lines kept.  The last
+*        line is the one TEXT is appended to, unless a new line was
+*        asked for.
+*      fill WIDGET INDEX FIRST LAST
+*        Insert the lines FIRST to LAST, each one followed by a
+*        newline, at INDEX in the text widget WIDGET.
+*      find STRING LINE DIRECTION
+*        Return the nearest line at or after (or before) LINE
+*        containing STRING, or 0 if there is none.  DIRECTION is
+*        forwards or backwards.
+*      limits ?LINES BYTES?
+*        Set how many lines and bytes of text to keep, and return
+*        them.  The oldest lines are dropped first.
+*      clear
+*        Drop all the text.
+* Tcl Result:
+*    As above.
+*/
+
+static int
+gdb_console (ClientData clientData, Tcl_Interp *interp,
+	     int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *commands[] =
+    {"append", "newline", "range", "fill", "find", "limits", "clear",
+     NULL};
+  enum commands_enum
+    {
+      CONSOLE_APPEND, CONSOLE_NEWLINE, CONSOLE_RANGE, CONSOLE_FILL,
+      CONSOLE_FIND, CONSOLE_LIMITS, CONSOLE_CLEAR
+    };
+  int cmd;
+
+  if (objc < 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "option ?arg...?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], commands, "options", 0,
+			   &cmd) != TCL_OK)
+    return TCL_ERROR;
+
+  switch ((enum commands_enum) cmd)
+    {
+    case CONSOLE_APPEND:
+      {
+	const char *text;
+	int len;
+
+	if (objc != 4)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "tag text");
+	    return TCL_ERROR;
+	  }
+
+	text = Tcl_GetStringFromObj (objv[3], &len);
+	console_log.append (Tcl_GetStringFromObj (objv[2], NULL), text, len);
+      }
+      break;
+
+    case CONSOLE_NEWLINE:
+      console_log.need_nl = true;
+      break;
+
+    case CONSOLE_RANGE:
+      {
+	Tcl_Obj *range[2];
+
+	range[0] = Tcl_NewIntObj (console_log.first);
+	range[1] = Tcl_NewIntObj (console_log.last ());
+	Tcl_SetListObj (result_ptr->obj_ptr, 2, range);
+      }
+      break;
+
+    case CONSOLE_FILL:
+      {
+	Tcl_CmdInfo text_cmd;
+	std::vector<const char *> text_argv;
+	std::string buf;
+	int first, last;
+
+	if (objc != 6)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "widget index first last");
+	    return TCL_ERROR;
+	  }
+	if (Tcl_GetIntFromObj (interp, objv[4], &first) != TCL_OK
+	    || Tcl_GetIntFromObj (interp, objv[5], &last) != TCL_OK)
+	  return TCL_ERROR;
+
+	first = std::max (first, console_log.first);
+	last = std::min (last, console_log.last ());
+	if (first > last)
+	  break;
+
+	if (!Tcl_GetCommandInfo (interp, Tcl_GetStringFromObj (objv[2], NULL),
+				 &text_cmd))
+	  {
+	    gdbtk_set_result (interp, "Can't get widget command info");
+	    return TCL_ERROR;
+	  }
+
+	text_argv.push_back (Tcl_GetStringFromObj (objv[2], NULL));
+	text_argv.push_back ("insert");
+	text_argv.push_back (Tcl_GetStringFromObj (objv[3], NULL));
+	console_log.fill (text_argv, buf, first, last);
+	text_argv.push_back (NULL);
+
+	if (text_cmd.proc (text_cmd.clientData, interp, text_argv.size () - 1,
+			   text_argv.data ()) != TCL_OK)
+	  return TCL_ERROR;
+	Tcl_ResetResult (interp);
+      }
+      break;
+
+    case CONSOLE_FIND:
+      {
+	static const char *directions[] = {"forwards", "backwards", NULL};
+	int line, direction;
+
+	if (objc != 5)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "string line direction");
+	    return TCL_ERROR;
+	  }
+	if (Tcl_GetIntFromObj (interp, objv[3], &line) != TCL_OK
+	    || Tcl_GetIndexFromObj (interp, objv[4], directions, "direction",
+				    0, &direction) != TCL_OK)
+	  return TCL_ERROR;
+
+	line = console_log.find (Tcl_GetStringFromObj (objv[2], NULL), line,
+				 direction == 0);
+	Tcl_SetIntObj (result_ptr->obj_ptr, line);
+      }
+      break;
+
+    case CONSOLE_LIMITS:
+      {
+	Tcl_Obj *limits[2];
+	int lines, bytes;
+
+	if (objc != 2 && objc != 4)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "?lines bytes?");
+	    return TCL_ERROR;
+	  }
+
+	if (objc == 4)
+	  {
+	    if (Tcl_GetIntFromObj (interp, objv[2], &lines) != TCL_OK
+		|| Tcl_GetIntFromObj (interp, objv[3], &bytes) != TCL_OK)
+	      return TCL_ERROR;
+	    console_log.max_lines = std::max (lines, 1);
+	    console_log.max_bytes = std::max (bytes, 1);
+	    console_log.trim ();
+	  }
+
+	limits[0] = Tcl_NewWideIntObj (console_log.max_lines);
+	limits[1] = Tcl_NewWideIntObj (console_log.max_bytes);
+	Tcl_SetListObj (result_ptr->obj_ptr, 2, limits);
+      }
+      break;
+
+    case CONSOLE_CLEAR:
+      console_log.first += console_log.lines.size ();
+      console_log.lines.clear ();
+      console_log.lines.emplace_back ();
+      console_log.bytes = 0;
+      console_log.need_nl = false;
+      break;
+    }
+
+  return TCL_OK;
+}
+
 /* This implements the tcl command "gdb_get_inferior_args"
 
 * Returns inferior command line arguments as a string
@@ -1462,13 +2143,472 @@ gdb_search (ClientData clientData, Tcl_Interp *interp,
   return TCL_OK;
 }
 
-/* This implements the tcl command gdb_listfuncs
+/* The names of all the functions of the program, with the file they
+   are defined in ("" if not known), sorted by name then file.  It is
+   built by the first gdb_search_functions and discarded when the
+   symbols change, which bumps function_index_generation.  The strings
+   belong to the objfiles.  */
 
-* It lists all the functions defined in a given file
-*
-* Arguments:
-*    file - the file to look in
-* Tcl Result:
+struct function_index_entry
+{
+  const char *name;
+  const char *filename;
+};
+
+static std::vector<function_index_entry> function_index;
+static bool function_index_valid = false;
+static unsigned long function_index_generation = 0;
+
+static bool
+function_index_less (const function_index_entry &a,
+		     const function_index_entry &b)
+{
+  int cmp = strcmp (a.name, b.name);
+
+  return cmp != 0 ? cmp < 0 : strcmp (a.filename, b.filename) < 0;
+}
+
+static void
+function_index_build (void)
+{
+  std::vector<symbol_search> ss;
+
+  function_index.clear ();
+  ss = search_symbols (NULL, FUNCTIONS_DOMAIN, NULL, 0, NULL);
+  for (const symbol_search &p : ss)
+    {
+      function_index_entry entry;
+
+      /* Strip off the same C++ special symbols as gdb_search.  */
+      if (p.msymbol.minsym != NULL)
+	entry.name = MSYMBOL_PRINT_NAME (p.msymbol.minsym);
+      else if (strncmp (SYMBOL_LINKAGE_NAME (p.symbol), "__tf", 4) != 0
+	       && strncmp (SYMBOL_LINKAGE_NAME (p.symbol), "_GLOBAL_", 8) != 0)
+	entry.name = SYMBOL_PRINT_NAME (p.symbol);
+      else
+	continue;
+
+      entry.filename = "";
+      if (p.symbol != NULL
+	  && symbol_symtab (p.symbol) != NULL
+	  && symbol_symtab (p.symbol)->filename != NULL)
+	entry.filename = symbol_symtab (p.symbol)->filename;
+
+      function_index.push_back (entry);
+    }
+
+  std::sort (function_index.begin (), function_index.end (),
+	     function_index_less);
+  function_index_valid = true;
+}
+
+/* Discard the function index.  */
+
+void
+gdbtk_function_index_flush (void)
+{
+  function_index.clear ();
+  function_index.shrink_to_fit ();
+  function_index_valid = false;
+  function_index_generation++;
+}
+
+/* A search of the function index, see gdb_search_functions.  A
+   streaming search is resumed from the event loop, and keeps the last
+   entry it looked at in case the index is rebuilt in the meantime.  */
+
+enum function_search_mode
+  {
+    FUNCTION_SEARCH_PREFIX, FUNCTION_SEARCH_SUBSTRING,
+    FUNCTION_SEARCH_SUFFIX, FUNCTION_SEARCH_GLOB, FUNCTION_SEARCH_REGEXP
+  };
+
+struct function_search
+{
+  enum function_search_mode mode;
+  Tcl_Obj *pattern;
+  std::vector<std::string> files;
+  int limit;
+  int count;
+
+  /* Where to resume.  */
+  size_t pos;
+  unsigned long generation;
+  std::string last_name, last_filename;
+
+  /* Streaming only: the callback, the number of matches it gets at a
+     time and the cancel variable (NULL if none).  */
+  Tcl_Obj *command;
+  int batch;
+  Tcl_Obj *cancel;
+};
+
+/* Number of index entries a streaming search looks at before going
+   back to the event loop, whatever it found.  */
+#define FUNCTION_SEARCH_STEP_ENTRIES 8192
+
+/* Look at the entries of the index from SEARCH->pos on, appending the
+   matches to LIST, until MAX_MATCHES of them have been found,
+   MAX_ENTRIES entries have been looked at (0 for no maximum, for
+   both), or the limit of the search is reached.  Return true when the
+   search is over.  */
+
+static bool
+function_search_step (Tcl_Interp *interp, function_search *search,
+		      int max_matches, int max_entries, Tcl_Obj *list)
+{
+  const char *pattern;
+  int pattern_len, found = 0, examined = 0;
+  Tcl_RegExp re = NULL;
+
+  pattern = Tcl_GetStringFromObj (search->pattern, &pattern_len);
+  if (search->mode == FUNCTION_SEARCH_REGEXP)
+    {
+      re = Tcl_GetRegExpFromObj (interp, search->pattern, TCL_REG_ADVANCED);
+      if (re == NULL)
+	return true;
+    }
+
+  if (!function_index_valid)
+    function_index_build ();
+
+  if (search->generation != function_index_generation)
+    {
+      /* The index was rebuilt: resume after the last entry seen.  */
+      function_index_entry last
+	= { search->last_name.c_str (), search->last_filename.c_str () };
+
+      search->pos = (std::upper_bound (function_index.begin (),
+				       function_index.end (), last,
+				       function_index_less)
+		     - function_index.begin ());
+      search->generation = function_index_generation;
+    }
+
+  if (search->mode == FUNCTION_SEARCH_PREFIX)
+    {
+      /* The names starting with PATTERN are together.  */
+      size_t first = (std::lower_bound (function_index.begin (),
+					function_index.end (), pattern,
+					[] (const function_index_entry &entry,
+					    const char *prefix)
+					{
+					  return strcmp (entry.name, prefix) < 0;
+					})
+		      - function_index.begin ());
+
+      search->pos = std::max (search->pos, first);
+    }
+
+  for (; search->pos < function_index.size (); search->pos++)
+    {
+      const function_index_entry &entry = function_index[search->pos];
+      const char *name = entry.name;
+      bool match = false;
+      Tcl_Obj *elem[2];
+
+      if ((search->limit > 0 && search->count >= search->limit)
+	  || (max_matches > 0 && found >= max_matches)
+	  || (max_entries > 0 && examined >= max_entries))
+	break;
+      examined++;
+
+      switch (search->mode)
+	{
+	case FUNCTION_SEARCH_PREFIX:
+	  match = strncmp (name, pattern, pattern_len) == 0;
+	  break;
+	case FUNCTION_SEARCH_SUBSTRING:
+	  match = strstr (name, pattern) != NULL;
+	  break;
+	case FUNCTION_SEARCH_SUFFIX:
+	  {
+	    size_t len = strlen (name);
+
+	    match = (len >= (size_t) pattern_len
+		     && strcmp (name + len - pattern_len, pattern) == 0);
+	  }
+	  break;
+	case FUNCTION_SEARCH_GLOB:
+	  match = Tcl_StringMatch (name, pattern);
+	  break;
+	case FUNCTION_SEARCH_REGEXP:
+	  match = Tcl_RegExpExec (interp, re, name, name) == 1;
+	  break;
+	}
+
+      /* Past the names starting with PATTERN.  */
+      if (!match && search->mode == FUNCTION_SEARCH_PREFIX)
+	{
+	  search->pos = function_index.size ();
+	  break;
+	}
+
+      if (match && !search->files.empty ())
+	{
+	  match = false;
+	  for (const std::string &file : search->files)
+	    if (compare_filenames_for_search (entry.filename, file.c_str ()))
+	      {
+		match = true;
+		break;
+	      }
+	}
+
+      if (!match)
+	continue;
+
+      elem[0] = Tcl_NewStringObj (name, -1);
+      elem[1] = Tcl_NewStringObj (entry.filename, -1);
+      Tcl_ListObjAppendElement (NULL, list, Tcl_NewListObj (2, elem));
+      search->count++;
+      found++;
+    }
+
+  if (search->pos > 0 && search->pos <= function_index.size ())
+    {
+      search->last_name = function_index[search->pos - 1].name;
+      search->last_filename = function_index[search->pos - 1].filename;
+    }
+
+  return (search->pos >= function_index.size ()
+	  || (search->limit > 0 && search->count >= search->limit));
+}
+
+static void
+function_search_free (function_search *search)
+{
+  Tcl_DecrRefCount (search->pattern);
+  if (search->command != NULL)
+    Tcl_DecrRefCount (search->command);
+  if (search->cancel != NULL)
+    Tcl_DecrRefCount (search->cancel);
+  delete search;
+}
+
+/* Run the next batch of the streaming search CLIENTDATA, and hand it
+   to its callback.  */
+
+static void
+function_search_batch (ClientData clientData)
+{
+  function_search *search = (function_search *) clientData;
+  Tcl_Interp *interp = gdbtk_get_interp ()->tcl;
+  Tcl_Obj *matches, *cmd;
+  bool done = false;
+  int val;
+
+  /* Leave the symbols alone while the target runs.  */
+  if (running_now)
+    {
+      Tcl_CreateTimerHandler (100, function_search_batch, search);
+      return;
+    }
+
+  /* Like download_cancel_ok, the cancel variable is polled.  It
+     going away, with the window that set it, cancels too.  */
+  if (search->cancel != NULL)
+    {
+      Tcl_Obj *var = Tcl_ObjGetVar2 (interp, search->cancel, NULL,
+				     TCL_GLOBAL_ONLY);
+
+      if (var == NULL
+	  || (Tcl_GetBooleanFromObj (NULL, var, &val) == TCL_OK && val))
+	{
+	  function_search_free (search);
+	  return;
+	}
+    }
+
+  matches = Tcl_NewListObj (0, NULL);
+  try
+    {
+      done = function_search_step (interp, search, search->batch,
+				   FUNCTION_SEARCH_STEP_ENTRIES, matches);
+    }
+  catch (const gdb_exception &ex)
+    {
+      exception_print (gdb_stderr, ex);
+      done = true;
+    }
+
+  /* The callback gets: command matches done.  */
+  cmd = Tcl_DuplicateObj (search->command);
+  Tcl_IncrRefCount (cmd);
+  Tcl_ListObjAppendElement (NULL, cmd, matches);
+  Tcl_ListObjAppendElement (NULL, cmd, Tcl_NewBooleanObj (done));
+  val = Tcl_EvalObjEx (interp, cmd, TCL_EVAL_GLOBAL);
+  Tcl_DecrRefCount (cmd);
+
+  /* The callback returns break to stop the search.  */
+  if (val == TCL_ERROR)
+    report_error ();
+  if (done || val == TCL_ERROR || val == TCL_BREAK)
+    {
+      function_search_free (search);
+      return;
+    }
+
+  Tcl_CreateTimerHandler (0, function_search_batch, search);
+}
+
+/* This implements the tcl command "gdb_search_functions"
+ *
+ * It looks the functions up in an index of their names, rather than
+ * through the symbol tables like gdb_search.
+ *
+ * Tcl Arguments:
+ *    mode - One of "prefix", "substring", "suffix", "glob" or "regexp",
+ *           how PATTERN is matched against the names.
+ *    pattern - What to look for.
+ * Then, optionally:
+ *    -files fileList - only the functions of these files.
+ *    -limit n - at most N functions (0, the default, for all).
+ *    -command cmd - stream the results: return at once, and call
+ *           "cmd matches done" from the event loop with each batch of
+ *           matches, DONE being 1 for the last one.  The search stops
+ *           if CMD returns break or fails.
+ *    -batch n - the number of matches CMD gets at a time (256).  A
+ *           batch has fewer, possibly none, when the search went
+ *           through many functions without finding enough, so that
+ *           a sparse search does not hold up the event loop.
+ *    -cancel varName - stop streaming once the global variable
+ *           VARNAME is true, or unset.
+ * Tcl Result:
+ *    A list of two element lists, the function name and the file it is
+ *    defined in ("" if not known), sorted by name.  Nothing when
+ *    streaming.
+ */
+
+static int
+gdb_search_functions (ClientData clientData, Tcl_Interp *interp,
+		      int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *modes[] =
+    {"prefix", "substring", "suffix", "glob", "regexp", (char *) NULL};
+  static const char *switches[] =
+    {"-files", "-limit", "-command", "-batch", "-cancel", (char *) NULL};
+  enum switches_opts
+    {
+      SWITCH_FILES, SWITCH_LIMIT, SWITCH_COMMAND, SWITCH_BATCH,
+      SWITCH_CANCEL
+    };
+  std::unique_ptr<function_search> search (new function_search ());
+  int mode, index, nfiles, i, j;
+  Tcl_Obj **file_list;
+
+  if (objc < 3 || (objc % 2) != 1)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv,
+			"mode pattern ?-files fileList? ?-limit n? "
+			"?-command cmd? ?-batch n? ?-cancel varName?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], modes, "mode", 0,
+			   &mode) != TCL_OK)
+    {
+      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  search->mode = (enum function_search_mode) mode;
+  search->limit = 0;
+  search->count = 0;
+  search->pos = 0;
+  search->generation = function_index_generation;
+  search->command = NULL;
+  search->batch = 256;
+  search->cancel = NULL;
+
+  for (i = 3; i < objc; i += 2)
+    {
+      if (Tcl_GetIndexFromObj (interp, objv[i], switches, "option", 0,
+			       &index) != TCL_OK)
+	{
+	  result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	  return TCL_ERROR;
+	}
+
+      switch ((enum switches_opts) index)
+	{
+	case SWITCH_FILES:
+	  if (Tcl_ListObjGetElements (interp, objv[i + 1], &nfiles,
+				      &file_list) != TCL_OK)
+	    {
+	      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	      return TCL_ERROR;
+	    }
+	  for (j = 0; j < nfiles; j++)
+	    search->files.push_back (Tcl_GetStringFromObj (file_list[j],
+							   NULL));
+	  break;
+	case SWITCH_LIMIT:
+	  if (Tcl_GetIntFromObj (interp, objv[i + 1], &search->limit)
+	      != TCL_OK)
+	    {
+	      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	      return TCL_ERROR;
+	    }
+	  break;
+	case SWITCH_COMMAND:
+	  search->command = objv[i + 1];
+	  break;
+	case SWITCH_BATCH:
+	  if (Tcl_GetIntFromObj (interp, objv[i + 1], &search->batch)
+	      != TCL_OK)
+	    {
+	      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	      return TCL_ERROR;
+	    }
+	  if (search->batch <= 0)
+	    {
+	      gdbtk_set_result (interp, "batch must be positive");
+	      return TCL_ERROR;
+	    }
+	  break;
+	case SWITCH_CANCEL:
+	  search->cancel = objv[i + 1];
+	  break;
+	}
+    }
+
+  /* Report a bad regexp now rather than from the event loop.  */
+  if (search->mode == FUNCTION_SEARCH_REGEXP
+      && Tcl_GetRegExpFromObj (interp, objv[2], TCL_REG_ADVANCED) == NULL)
+    {
+      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  search->pattern = objv[2];
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+
+  if (search->command == NULL)
+    {
+      function_search_step (interp, search.get (), 0, 0,
+			    result_ptr->obj_ptr);
+      return TCL_OK;
+    }
+
+  /* The first batch comes once the caller is back in the event loop,
+     so it can show it at once.  */
+  Tcl_IncrRefCount (search->pattern);
+  Tcl_IncrRefCount (search->command);
+  if (search->cancel != NULL)
+    Tcl_IncrRefCount (search->cancel);
+  Tcl_CreateTimerHandler (0, function_search_batch, search.release ());
+
+  return TCL_OK;
+}
+
+/* This implements the tcl command gdb_listfuncs
+
+* It lists all the functions defined in a given file
+*
+* Arguments:
+*    file - the file to look in
+* Tcl Result:
 *    A list of two element lists, the first element is
 *    the symbol name, and the second is a boolean indicating
 *    whether the symbol is demangled (1 for yes).
@@ -1573,34 +2713,127 @@ gdb_restore_write (ClientData clientData, Tcl_Interp *interp,
 /* This implements the tcl command gdb_load_disassembly
  *
  * Arguments:
+ *    ?-count n? - stop after about N instructions: the rest of the
+ *                 range can then be loaded by further calls.
+ *    ?-through address? - with -count, don't stop before ADDRESS is
+ *                 loaded, so that it can be displayed at once.
+ *    ?-resume cursor? - go on loading from CURSOR, as returned by the
+ *                 previous call.
+ *    ?-index index? - fill the line index object INDEX, created by
+ *                 gdb_asm_index, instead of a map array.  The index is
+ *                 cleared first, unless -resume is given.
  *    widget - the name of a text widget into which to load the data
  *    source_with_assm - must be "source" or "nosource"
+ *    map_arr - the name of the map array to fill, see below, or ""
+ *    index_prefix - the prefix of the map array indices
  *    low_address - the CORE_ADDR from which to start disassembly
  *    ?hi_address? - the CORE_ADDR to which to disassemble, defaults
  *                   to the end of the function containing low_address.
  * Tcl Result:
- *    The text widget is loaded with the data, and a list is returned.
- *    The first element of the list is a two element list containing the
- *    real low & high elements, the rest is a mapping between line number
- *    in the text widget, and either the source line number of that line,
- *    if it is a source line, or the assembly address.  You can distinguish
- *    between the two, because the address will start with 0x...
+ *    The text widget is loaded with the data, and a list is returned,
+ *    containing the real low & high addresses and, if the range was
+ *    not completely loaded, the cursor to pass to -resume.
  */
 
 static int
 gdb_load_disassembly (ClientData clientData, Tcl_Interp *interp,
 		      int objc, Tcl_Obj *CONST objv[])
 {
+  static const char *options[] =
+    {"-count", "-through", "-resume", "-index", NULL};
+  enum options_enum { OPT_COUNT, OPT_THROUGH, OPT_RESUME, OPT_INDEX };
   CORE_ADDR low, high, orig;
   struct disassembly_client_data client_data;
-  int mixed_source_and_assembly, ret_val, i;
+  struct disassembly_cursor cursor;
+  int mixed_source_and_assembly, ret_val, i, index;
   char *arg_ptr;
   char *map_name;
   Tcl_WideInt waddr;
 
+  memset (&cursor, 0, sizeof (cursor));
+  client_data.widget_line_no = 0;
+  client_data.record = NULL;
+  client_data.index = NULL;
+
+  while (objc > 1 && *Tcl_GetStringFromObj (objv[1], NULL) == '-')
+    {
+      if (Tcl_GetIndexFromObj (interp, objv[1], options, "option", 0,
+			       &index) != TCL_OK)
+	{
+	  result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	  return TCL_ERROR;
+	}
+
+      if (objc < 3)
+	{
+	  gdbtk_set_result (interp, "missing value for %s",
+			    Tcl_GetStringFromObj (objv[1], NULL));
+	  return TCL_ERROR;
+	}
+
+      switch ((enum options_enum) index)
+	{
+	case OPT_COUNT:
+	  if (Tcl_GetIntFromObj (interp, objv[2], &cursor.limit) != TCL_OK)
+	    {
+	      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+	      return TCL_ERROR;
+	    }
+	  break;
+
+	case OPT_THROUGH:
+	  cursor.through
+	    = string_to_core_addr (Tcl_GetStringFromObj (objv[2], NULL));
+	  break;
+
+	case OPT_RESUME:
+	  {
+	    Tcl_Obj **elems;
+	    int nelems;
+
+	    if (Tcl_ListObjGetElements (interp, objv[2], &nelems,
+					&elems) != TCL_OK
+		|| nelems != 4
+		|| Tcl_GetIntFromObj (interp, elems[1], &cursor.entry) != TCL_OK
+		|| Tcl_GetIntFromObj (interp, elems[2],
+				      &cursor.next_line) != TCL_OK
+		|| Tcl_GetIntFromObj (interp, elems[3],
+				      &client_data.widget_line_no) != TCL_OK)
+	      {
+		gdbtk_set_result (interp, "Invalid disassembly cursor.");
+		return TCL_ERROR;
+	      }
+	    cursor.pc
+	      = string_to_core_addr (Tcl_GetStringFromObj (elems[0], NULL));
+	    cursor.started = 1;
+	  }
+	  break;
+
+	case OPT_INDEX:
+	  {
+	    Tcl_CmdInfo info;
+
+	    if (!Tcl_GetCommandInfo (interp,
+				     Tcl_GetStringFromObj (objv[2], NULL),
+				     &info)
+		|| info.objProc != asm_index_obj_command)
+	      {
+		gdbtk_set_result (interp, "Invalid line index \"%s\".",
+				  Tcl_GetStringFromObj (objv[2], NULL));
+		return TCL_ERROR;
+	      }
+	    client_data.index = (struct gdbtk_asm_index *) info.objClientData;
+	  }
+	  break;
+	}
+
+      objc -= 2;
+      objv += 2;
+    }
+
   if (objc != 6 && objc != 7)
     {
-      Tcl_WrongNumArgs (interp, 1, objv, "[source|nosource] map_arr index_prefix low_address ?hi_address");
+      Tcl_WrongNumArgs (interp, 1, objv, "?-count n? ?-through addr? ?-resume cursor? widget [source|nosource] map_arr index_prefix low_address ?hi_address");
       return TCL_ERROR;
     }
 
@@ -1700,10 +2933,12 @@ gdb_load_disassembly (ClientData clientData, Tcl_Interp *interp,
       high = waddr;
     }
 
+  if (client_data.index != NULL && !cursor.started)
+    client_data.index->clear ();
+
   /* Setup the client_data structure, and call the driver function. */
 
   client_data.file_opened_p = 0;
-  client_data.widget_line_no = 0;
   client_data.interp = interp;
   for (i = 0; i < 3; i++)
     {
@@ -1738,9 +2973,62 @@ gdb_load_disassembly (ClientData clientData, Tcl_Interp *interp,
       client_data.source_argv[6] = "source_tag2";
     }
 
-  ret_val = gdb_disassemble_driver (low, high, mixed_source_and_assembly,
-				    (ClientData) &client_data,
-				    gdbtk_load_source, gdbtk_load_asm);
+  /* Replay the range from the disassembly cache if it's there, else
+     record it as it's loaded.  */
+
+  std::string key = disassembly_cache_key (low, high,
+					   mixed_source_and_assembly);
+  const disassembly_cache_entry *replay = NULL;
+
+  if (!key.empty ())
+    {
+      auto it = disassembly_cache.find (key);
+
+      if (it != disassembly_cache.end () && it->second.complete)
+	{
+	  if (!cursor.started)
+	    replay = &it->second;
+	}
+      else if (!cursor.started)
+	{
+	  /* Record a new load, forgetting any unfinished one.  */
+	  if (it == disassembly_cache.end ()
+	      && disassembly_cache.size () >= GDBTK_DISASSEMBLY_CACHE_SIZE)
+	    disassembly_cache.clear ();
+	  client_data.record = &disassembly_cache[key];
+	  client_data.record->lines.clear ();
+	  client_data.record->low = low;
+	  client_data.record->high = high;
+	}
+      else if (it != disassembly_cache.end ()
+	       && (it->second.lines.size ()
+		   == (size_t) client_data.widget_line_no))
+	client_data.record = &it->second;
+      else if (it != disassembly_cache.end ())
+	disassembly_cache.erase (it);
+    }
+
+  if (replay != NULL)
+    {
+      for (const disassembly_line &line : replay->lines)
+	if (line.source_line)
+	  gdbtk_emit_source_line (&client_data, line.source_line,
+				  line.text[0].c_str ());
+	else
+	  gdbtk_emit_asm_line (&client_data, line.pc, line.text[0].c_str (),
+			       line.text[1].c_str (), line.text[2].c_str ());
+      cursor.done = 1;
+      ret_val = TCL_OK;
+    }
+  else
+    {
+      ret_val = gdb_disassemble_driver (low, high, mixed_source_and_assembly,
+					(ClientData) &client_data,
+					gdbtk_load_source, gdbtk_load_asm,
+					&cursor);
+      if (client_data.record != NULL && cursor.done)
+	client_data.record->complete = true;
+    }
 
   /* Now clean up the opened file, and the Tcl data structures */
 
@@ -1768,6 +3056,17 @@ gdb_load_disassembly (ClientData clientData, Tcl_Interp *interp,
 				Tcl_NewStringObj (core_addr_to_string (low), -1));
       Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
 				Tcl_NewStringObj (core_addr_to_string (high), -1));
+      if (!cursor.done)
+	{
+	  Tcl_Obj *elems[4];
+
+	  elems[0] = Tcl_NewStringObj (core_addr_to_string (cursor.pc), -1);
+	  elems[1] = Tcl_NewIntObj (cursor.entry);
+	  elems[2] = Tcl_NewIntObj (cursor.next_line);
+	  elems[3] = Tcl_NewIntObj (client_data.widget_line_no);
+	  Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				    Tcl_NewListObj (4, elems));
+	}
     }
   return ret_val;
 }
@@ -1778,15 +3077,10 @@ gdbtk_load_source (ClientData clientData, struct symtab *symtab,
 {
   struct disassembly_client_data *client_data =
     (struct disassembly_client_data *) clientData;
-  char *buffer;
-  int index_len;
-
-  index_len = Tcl_DStringLength (&client_data->src_to_line_prefix);
 
   if (client_data->file_opened_p == 1)
     {
-      const char **text_argv;
-      char line[10000], line_number[18];
+      char line[10000];
       int found_carriage_return = 1;
 
       /* First do some sanity checks on the requested lines */
@@ -1797,14 +3091,8 @@ gdbtk_load_source (ClientData clientData, struct symtab *symtab,
 	  return;
 	}
 
-      line_number[0] = '\t';
       line[0] = '\t';
 
-      text_argv = client_data->source_argv;
-
-      text_argv[3] = line_number;
-      text_argv[5] = line;
-
       if (fseek (client_data->fp, symtab->line_charpos[start_line - 1],
 		 SEEK_SET) < 0)
 	{
@@ -1822,10 +3110,6 @@ gdbtk_load_source (ClientData clientData, struct symtab *symtab,
 	      return;
 	    }
 
-	  client_data->widget_line_no++;
-
-	  sprintf (line_number + 1, "%d", start_line);
-
 	  if (found_carriage_return)
 	    {
 	      char *p = strrchr(line, '\0') - 2;
@@ -1838,30 +3122,7 @@ gdbtk_load_source (ClientData clientData, struct symtab *symtab,
 		found_carriage_return = 0;
 	    }
 
-	  /* Run the command, then add an entry to the map array in
-	     the caller's scope, if requested. */
-
-	  client_data->cmd.proc (client_data->cmd.clientData,
-				 client_data->interp, 7, text_argv);
-
-	  if (*client_data->map_arr != '\0')
-	    {
-
-	      Tcl_DStringAppend (&client_data->src_to_line_prefix,
-				 line_number + 1, -1);
-
-	      /* FIXME: Convert to Tcl_SetVar2Ex when we move to 8.2.  This
-		 will allow us avoid converting widget_line_no into a string. */
-
-	      buffer = xstrprintf ("%d", client_data->widget_line_no);
-
-	      Tcl_SetVar2 (client_data->interp, client_data->map_arr,
-			   Tcl_DStringValue (&client_data->src_to_line_prefix),
-			   buffer, 0);
-	      free(buffer);
-
-	      Tcl_DStringSetLength (&client_data->src_to_line_prefix, index_len);
-	    }
+	  gdbtk_emit_source_line (client_data, start_line, line);
 	}
 
     }
@@ -1909,17 +3170,11 @@ gdbtk_load_asm (ClientData clientData, CORE_ADDR pc,
 {
   struct disassembly_client_data * client_data
     = (struct disassembly_client_data *) clientData;
-  const char **text_argv;
-  int i, pc_to_line_len, line_to_pc_len;
+  int i;
   gdbtk_result new_result;
   gdbtk_result *old_result_ptr;
   int insn;
 
-  pc_to_line_len = Tcl_DStringLength (&client_data->pc_to_line_prefix);
-  line_to_pc_len = Tcl_DStringLength (&client_data->line_to_pc_prefix);
-
-  text_argv = client_data->asm_argv;
-
   /* Preserve the current Tcl result object, print out what we need, and then
      suck it out of the result, and replace... */
 
@@ -1946,56 +3201,408 @@ gdbtk_load_asm (ClientData clientData, CORE_ADDR pc,
       /* FIXME: cagney/2003-09-08: This should use gdb_disassembly.  */
       insn = gdb_print_insn (get_current_arch (), pc, gdb_stdout, NULL);
       gdb_flush (gdb_stdout);
+    }
+  catch (const gdb_exception &)
+    {
+      result_ptr = old_result_ptr;
+      throw;
+    }
+
+  result_ptr = old_result_ptr;
 
-      client_data->widget_line_no++;
+  gdbtk_emit_asm_line (client_data, pc,
+		       Tcl_GetStringFromObj (client_data->result_obj[0], NULL),
+		       Tcl_GetStringFromObj (client_data->result_obj[1], NULL),
+		       Tcl_GetStringFromObj (client_data->result_obj[2], NULL));
 
-      text_argv[5] = Tcl_GetStringFromObj (client_data->result_obj[0], NULL);
-      text_argv[7] = Tcl_GetStringFromObj (client_data->result_obj[1], NULL);
-      text_argv[11] = Tcl_GetStringFromObj (client_data->result_obj[2], NULL);
+  return pc + insn;
+}
 
-      client_data->cmd.proc (client_data->cmd.clientData,
-			     client_data->interp, 14, text_argv);
+/* Insert the source line LINE (prefixed with a tab) numbered LINE_NO
+   into the disassembly widget, and add it to the map array in the
+   caller's scope, if requested.  */
 
-      if (*client_data->map_arr != '\0')
-        {
-          std::string buffer;
+static void
+gdbtk_emit_source_line (struct disassembly_client_data *client_data,
+			int line_no, const char *line)
+{
+  const char **text_argv = client_data->source_argv;
+  char line_number[18];
 
-          /* Run the command, then add an entry to the map array in
-	     the caller's scope. */
+  client_data->widget_line_no++;
+  if (client_data->record != NULL)
+    {
+      disassembly_line entry;
 
-          Tcl_DStringAppend (&client_data->pc_to_line_prefix, core_addr_to_string (pc), -1);
+      entry.pc = 0;
+      entry.source_line = line_no;
+      entry.text[0] = line;
+      client_data->record->lines.push_back (std::move (entry));
+    }
 
-          /* FIXME: Convert to Tcl_SetVar2Ex when we move to 8.2.  This
-	     will allow us avoid converting widget_line_no into a string. */
+  sprintf (line_number, "\t%d", line_no);
+  text_argv[3] = line_number;
+  text_argv[5] = line;
 
-          buffer = string_printf ("%d", client_data->widget_line_no);
+  client_data->cmd.proc (client_data->cmd.clientData,
+			 client_data->interp, 7, text_argv);
 
-          Tcl_SetVar2 (client_data->interp, client_data->map_arr,
-		       Tcl_DStringValue (&client_data->pc_to_line_prefix),
-		       buffer.c_str (), 0);
+  if (client_data->index != NULL)
+    {
+      client_data->index->src_to_line.emplace_back
+	(line_no, client_data->widget_line_no);
+      client_data->index->sorted = false;
+    }
+  else if (*client_data->map_arr != '\0')
+    {
+      int index_len = Tcl_DStringLength (&client_data->src_to_line_prefix);
+      std::string buffer;
 
-          Tcl_DStringAppend (&client_data->line_to_pc_prefix, buffer.c_str (), -1);
+      Tcl_DStringAppend (&client_data->src_to_line_prefix,
+			 line_number + 1, -1);
 
+      /* FIXME: Convert to Tcl_SetVar2Ex when we move to 8.2.  This
+	 will allow us avoid converting widget_line_no into a string. */
 
-          Tcl_SetVar2 (client_data->interp, client_data->map_arr,
-		       Tcl_DStringValue (&client_data->line_to_pc_prefix),
-		       core_addr_to_string (pc), 0);
+      buffer = string_printf ("%d", client_data->widget_line_no);
 
-          /* Restore the prefixes to their initial state. */
+      Tcl_SetVar2 (client_data->interp, client_data->map_arr,
+		   Tcl_DStringValue (&client_data->src_to_line_prefix),
+		   buffer.c_str (), 0);
 
-          Tcl_DStringSetLength (&client_data->pc_to_line_prefix, pc_to_line_len);
-          Tcl_DStringSetLength (&client_data->line_to_pc_prefix, line_to_pc_len);
-        }
+      Tcl_DStringSetLength (&client_data->src_to_line_prefix, index_len);
     }
-  catch (const gdb_exception &)
+}
+
+/* Insert the instruction at PC, whose address, symbolic offset and code
+   texts are ADDRESS, OFFSET and CODE, into the disassembly widget, and
+   add it to the map array in the caller's scope, if requested.  */
+
+static void
+gdbtk_emit_asm_line (struct disassembly_client_data *client_data,
+		     CORE_ADDR pc, const char *address, const char *offset,
+		     const char *code)
+{
+  const char **text_argv = client_data->asm_argv;
+
+  client_data->widget_line_no++;
+  if (client_data->record != NULL)
     {
-      result_ptr = old_result_ptr;
-      throw;
+      disassembly_line entry;
+
+      entry.pc = pc;
+      entry.source_line = 0;
+      entry.text[0] = address;
+      entry.text[1] = offset;
+      entry.text[2] = code;
+      client_data->record->lines.push_back (std::move (entry));
     }
 
-  result_ptr = old_result_ptr;
+  text_argv[5] = address;
+  text_argv[7] = offset;
+  text_argv[11] = code;
 
-  return pc + insn;
+  client_data->cmd.proc (client_data->cmd.clientData,
+			 client_data->interp, 14, text_argv);
+
+  if (client_data->index != NULL)
+    {
+      client_data->index->line_to_pc.emplace_back
+	(client_data->widget_line_no, pc);
+      client_data->index->pc_to_line.emplace_back
+	(pc, client_data->widget_line_no);
+      client_data->index->sorted = false;
+    }
+  else if (*client_data->map_arr != '\0')
+    {
+      int pc_to_line_len, line_to_pc_len;
+      std::string buffer;
+
+      pc_to_line_len = Tcl_DStringLength (&client_data->pc_to_line_prefix);
+      line_to_pc_len = Tcl_DStringLength (&client_data->line_to_pc_prefix);
+
+      Tcl_DStringAppend (&client_data->pc_to_line_prefix,
+			 core_addr_to_string (pc), -1);
+
+      /* FIXME: Convert to Tcl_SetVar2Ex when we move to 8.2.  This
+	 will allow us avoid converting widget_line_no into a string. */
+
+      buffer = string_printf ("%d", client_data->widget_line_no);
+
+      Tcl_SetVar2 (client_data->interp, client_data->map_arr,
+		   Tcl_DStringValue (&client_data->pc_to_line_prefix),
+		   buffer.c_str (), 0);
+
+      Tcl_DStringAppend (&client_data->line_to_pc_prefix, buffer.c_str (),
+			 -1);
+
+      Tcl_SetVar2 (client_data->interp, client_data->map_arr,
+		   Tcl_DStringValue (&client_data->line_to_pc_prefix),
+		   core_addr_to_string (pc), 0);
+
+      /* Restore the prefixes to their initial state. */
+
+      Tcl_DStringSetLength (&client_data->pc_to_line_prefix, pc_to_line_len);
+      Tcl_DStringSetLength (&client_data->line_to_pc_prefix, line_to_pc_len);
+    }
+}
+
+/* Return the disassembly cache key of the range LOW..HIGH, or an empty
+   string if it can't be cached.  The key identifies the objfile by
+   name and modification time, so that a rebuilt executable is
+   disassembled again, and where the code is read from.  In mixed
+   mode, the source file is identified the same way.  The disassembler
+   settings are not part of it: gdbtk_param_changed flushes the cache
+   when they change.  */
+
+static std::string
+disassembly_cache_key (CORE_ADDR low, CORE_ADDR high, int mixed)
+{
+  struct obj_section *osect = find_pc_section (low);
+  std::string key;
+
+  if (osect == NULL || osect->objfile->obfd == NULL)
+    return key;
+
+  key = string_printf ("%s:%ld:%s:%s:%d", objfile_name (osect->objfile),
+		       (long) bfd_get_mtime (osect->objfile->obfd),
+		       core_addr_to_string (low), core_addr_to_string (high),
+		       disassemble_from_exec);
+
+  if (mixed)
+    {
+      struct compunit_symtab *cu = find_pc_compunit_symtab (low);
+
+      key += ":mixed";
+      if (cu != NULL && COMPUNIT_FILETABS (cu) != NULL)
+	{
+	  const char *fullname = symtab_to_fullname (COMPUNIT_FILETABS (cu));
+	  struct stat st;
+
+	  if (stat (fullname, &st) == 0)
+	    key += string_printf (":%s:%ld", fullname, (long) st.st_mtime);
+	}
+    }
+
+  return key;
+}
+
+/* Sort the lookup tables of the index.  Sorting is stable, so that the
+   last of several lines with the same key comes last.  */
+
+void
+gdbtk_asm_index::sort ()
+{
+  if (sorted)
+    return;
+
+  std::stable_sort (pc_to_line.begin (), pc_to_line.end (),
+		    [] (const std::pair<CORE_ADDR, int> &a,
+			const std::pair<CORE_ADDR, int> &b)
+		    { return a.first < b.first; });
+  std::stable_sort (src_to_line.begin (), src_to_line.end (),
+		    [] (const std::pair<int, int> &a,
+			const std::pair<int, int> &b)
+		    { return a.first < b.first; });
+  sorted = true;
+}
+
+/* Return the value of the last entry of the sorted table TABLE whose
+   key is KEY, or -1 if there is none.  */
+
+template<typename K>
+static int
+asm_index_lookup (const std::vector<std::pair<K, int>> &table, K key)
+{
+  auto it = std::upper_bound (table.begin (), table.end (), key,
+			      [] (K k, const std::pair<K, int> &e)
+			      { return k < e.first; });
+
+  if (it == table.begin () || (it - 1)->first != key)
+    return -1;
+  return (it - 1)->second;
+}
+
+/* This implements the Tcl command 'gdb_asm_index', which creates the
+ * line index of a disassembly text widget.
+ *
+ * Arguments:
+ *   gdb_asm_index create ?name?
+ *
+ *   name: name of the object command to create.  One is generated if
+ *         not given.
+ *
+ * Return:
+ * the name of the new object command, to pass to the -index option of
+ * gdb_load_disassembly.  Its subcommands are:
+ *
+ *   pc2line address
+ *     Return the widget line of the instruction at ADDRESS.
+ *   line2pc line
+ *     Return the address of the instruction at widget line LINE.
+ *   src2line line
+ *     Return the widget line of the source line LINE, in mixed mode.
+ *   delete
+ *     Delete the object command.
+ *
+ * The lookups return an empty string when there is no such line.  */
+
+static int
+gdb_asm_index (ClientData clientData, Tcl_Interp *interp,
+	       int objc, Tcl_Obj *CONST objv[])
+{
+  static int asm_index_count = 0;
+  std::string name;
+
+  if (objc < 2 || objc > 3
+      || strcmp (Tcl_GetStringFromObj (objv[1], NULL), "create"))
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "create ?name?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 3)
+    name = Tcl_GetStringFromObj (objv[2], NULL);
+  else
+    name = string_printf ("asmindex%d", ++asm_index_count);
+
+  Tcl_CreateObjCommand (interp, name.c_str (), asm_index_obj_command,
+			(ClientData) new gdbtk_asm_index, asm_index_delete);
+  Tcl_SetStringObj (result_ptr->obj_ptr, name.c_str (), -1);
+  return TCL_OK;
+}
+
+/* This function implements the object command of a line index.
+   See gdb_asm_index for the subcommands.  */
+
+static int
+asm_index_obj_command (ClientData clientData, Tcl_Interp *interp,
+		       int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *commands[] =
+    {"pc2line", "line2pc", "src2line", "delete", NULL};
+  enum commands_enum
+    {
+      INDEX_PC2LINE, INDEX_LINE2PC, INDEX_SRC2LINE, INDEX_DELETE
+    };
+  struct gdbtk_asm_index *index = (struct gdbtk_asm_index *) clientData;
+  int cmd, line, result = -1;
+
+  if (objc < 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "option ?arg?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], commands, "options", 0,
+			   &cmd) != TCL_OK)
+    return TCL_ERROR;
+
+  if (cmd == INDEX_DELETE)
+    {
+      Tcl_DeleteCommand (interp, Tcl_GetStringFromObj (objv[0], NULL));
+      return TCL_OK;
+    }
+
+  if (objc != 3)
+    {
+      Tcl_WrongNumArgs (interp, 2, objv,
+			cmd == INDEX_PC2LINE ? "address" : "line");
+      return TCL_ERROR;
+    }
+
+  index->sort ();
+  switch ((enum commands_enum) cmd)
+    {
+    case INDEX_PC2LINE:
+      try
+	{
+	  CORE_ADDR pc
+	    = string_to_core_addr (Tcl_GetStringFromObj (objv[2], NULL));
+
+	  result = asm_index_lookup (index->pc_to_line, pc);
+	}
+      catch (const gdb_exception_error &)
+	{
+	  /* Not an address: no such line.  */
+	}
+      break;
+
+    case INDEX_LINE2PC:
+      {
+	if (Tcl_GetIntFromObj (interp, objv[2], &line) != TCL_OK)
+	  return TCL_ERROR;
+
+	auto it = std::lower_bound (index->line_to_pc.begin (),
+				    index->line_to_pc.end (), line,
+				    [] (const std::pair<int, CORE_ADDR> &e,
+					int l)
+				    { return e.first < l; });
+
+	if (it != index->line_to_pc.end () && it->first == line)
+	  Tcl_SetObjResult (interp,
+			    Tcl_NewStringObj (core_addr_to_string (it->second),
+					      -1));
+	return TCL_OK;
+      }
+
+    case INDEX_SRC2LINE:
+      if (Tcl_GetIntFromObj (interp, objv[2], &line) != TCL_OK)
+	return TCL_ERROR;
+      result = asm_index_lookup (index->src_to_line, line);
+      break;
+
+    default:
+      break;
+    }
+
+  if (result >= 0)
+    Tcl_SetObjResult (interp, Tcl_NewIntObj (result));
+  return TCL_OK;
+}
+
+/* Tcl delete proc of line index object commands.  */
+
+static void
+asm_index_delete (ClientData clientData)
+{
+  delete (struct gdbtk_asm_index *) clientData;
+}
+
+/* Discard the disassembly cache.  This is called whenever symbols are
+   loaded, as they may change the symbolic addresses.  */
+
+void
+gdbtk_disassembly_cache_flush (void)
+{
+  disassembly_cache.clear ();
+}
+
+/* Discard the cached disassembly of the ranges overlapping the LEN
+   bytes written at ADDR: the code may have been patched.  */
+
+void
+gdbtk_disassembly_cache_invalidate (CORE_ADDR addr, LONGEST len)
+{
+  for (auto it = disassembly_cache.begin ();
+       it != disassembly_cache.end (); )
+    {
+      if (it->second.low < addr + len && addr < it->second.high)
+	it = disassembly_cache.erase (it);
+      else
+	++it;
+    }
+}
+
+/* Return true if the chunk of CURSOR is complete before the instruction
+   at PC: once the chunk limit is reached, we stop at the first
+   instruction past CURSOR->through.  */
+
+static int
+disassembly_chunk_full (struct disassembly_cursor *cursor, CORE_ADDR pc)
+{
+  return (cursor->limit > 0 && cursor->printed >= cursor->limit
+	  && pc > cursor->through);
 }
 
 static int
@@ -2003,7 +3610,8 @@ gdb_disassemble_driver (CORE_ADDR low, CORE_ADDR high,
 			int mixed_source_and_assembly,
 			ClientData clientData,
 			void (*print_source_fn) (ClientData, struct symtab *, int, int),
-			CORE_ADDR (*print_asm_fn) (ClientData, CORE_ADDR, struct disassemble_info *))
+			CORE_ADDR (*print_asm_fn) (ClientData, CORE_ADDR, struct disassemble_info *),
+			struct disassembly_cursor *cursor)
 {
   CORE_ADDR pc;
 
@@ -2102,7 +3710,13 @@ gdb_disassemble_driver (CORE_ADDR low, CORE_ADDR high,
 	 been emitted before), followed by the assembly code for that line.  */
 
       next_line = 0;		/* Force out first line */
-      for (i = 0; i < newlines; i++)
+      i = 0;
+      if (cursor->started)
+	{
+	  next_line = cursor->next_line;
+	  i = cursor->entry;
+	}
+      for (; i < newlines; i++)
         {
           /* Print out everything from next_line to the current line.  */
 
@@ -2118,27 +3732,48 @@ gdb_disassemble_driver (CORE_ADDR low, CORE_ADDR high,
               next_line = mle[i].line + 1;
             }
 
-          for (pc = mle[i].start_pc; pc < mle[i].end_pc; )
+	  pc = mle[i].start_pc;
+	  if (cursor->started && i == cursor->entry)
+	    pc = cursor->pc;
+          for (; pc < mle[i].end_pc; )
             {
               QUIT;
+	      if (disassembly_chunk_full (cursor, pc))
+		{
+		  cursor->pc = pc;
+		  cursor->entry = i;
+		  cursor->next_line = next_line;
+		  return TCL_OK;
+		}
 	      /* FIXME: cagney/2003-09-08: This entire function should
                  be replaced by gdb_disassembly.  */
 	      pc = print_asm_fn (clientData, pc, NULL);
+	      cursor->printed++;
             }
         }
     }
   else
     {
     assembly_only:
-      for (pc = low; pc < high; )
+      pc = cursor->started ? cursor->pc : low;
+      for (; pc < high; )
         {
           QUIT;
+	  if (disassembly_chunk_full (cursor, pc))
+	    {
+	      cursor->pc = pc;
+	      cursor->entry = 0;
+	      cursor->next_line = 0;
+	      return TCL_OK;
+	    }
 	  /* FIXME: cagney/2003-09-08: This entire function should be
 	     replaced by gdb_disassembly.  */
 	  pc = print_asm_fn (clientData, pc, NULL);
+	  cursor->printed++;
         }
     }
 
+  cursor->done = 1;
   return TCL_OK;
 }
 
@@ -2398,7 +4033,10 @@ gdb_set_mem (ClientData clientData, Tcl_Interp *interp,
       return TCL_ERROR;
     }
 
-  target_write_memory (addr, buf, len);
+  if (target_write_memory (addr, buf, len) == 0)
+    memory_cache.write (addr, buf, len);
+  else
+    memory_cache.invalidate (addr, len);
   return TCL_OK;
 }
 
@@ -2419,7 +4057,15 @@ gdb_set_mem (ClientData clientData, Tcl_Interp *interp,
  *
  * Return:
  * a list of three integers: {border_col_width data_col_width ascii_col_width}
- * which can be used to set the table's column widths. */
+ * which can be used to set the table's column widths.
+ *
+ * Alternate form:
+ *   gdb_update_mem -binary addr nbytes
+ *
+ * Return:
+ * the raw memory contents as a byte array.  The array is shorter than
+ * NBYTES, or empty, if only part or none of the block could be read.
+ * Cells are then formatted on demand with gdb_format_mem. */
 
 static int
 gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
@@ -2428,9 +4074,9 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
   char index[20];
   CORE_ADDR addr;
   int nbytes, rnum, bpr;
-  int size, asize, i, j, bc;
+  int size, i, j, bc;
   int max_ascii_len, max_val_len, max_label_len;
-  char format, aschar;
+  char format, aschar, asize;
   char *data, *tmp;
   char buff[128], *bptr;
   std::vector<gdb_byte> mbuf;
@@ -2438,6 +4084,10 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
   string_file stb;
   struct type *val_type;
 
+  if (objc > 1 && strcmp (Tcl_GetStringFromObj (objv[1], NULL),
+			  "-binary") == 0)
+    return gdb_update_mem_binary (interp, objc, objv);
+
   if (objc < 7 || objc > 8)
     {
       Tcl_WrongNumArgs (interp, 1, objv, "data addr format size bytes bytes_per_row ?ascii_char?");
@@ -2502,8 +4152,7 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
     }
 
   mptr = cptr = mbuf.data ();
-  rnum = target_read (current_top_target (), TARGET_OBJECT_MEMORY, NULL,
-		      mbuf.data (), addr, nbytes);
+  rnum = memory_cache.read (addr, mbuf.data (), nbytes);
   if (rnum <= 0)
     {
       gdbtk_set_result (interp, "Unable to read memory.");
@@ -2515,28 +4164,7 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
   else
     aschar = 0;
 
-  switch (size)
-    {
-    case 1:
-      val_type = builtin_type (get_current_arch ())->builtin_int8;
-      asize = 'b';
-      break;
-    case 2:
-      val_type = builtin_type (get_current_arch ())->builtin_int16;
-      asize = 'h';
-      break;
-    case 4:
-      val_type = builtin_type (get_current_arch ())->builtin_int32;
-      asize = 'w';
-      break;
-    case 8:
-      val_type = builtin_type (get_current_arch ())->builtin_int64;
-      asize = 'g';
-      break;
-    default:
-      val_type = builtin_type (get_current_arch ())->builtin_int8;
-      asize = 'b';
-    }
+  val_type = memory_cell_type (size, &asize);
 
   bc = 0;			/* count of bytes in a row */
   bptr = &buff[0];		/* pointer for ascii dump */
@@ -2588,12 +4216,8 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
 	}
       else
 	{
-	  struct value_print_options opts;
-
-	  get_formatted_print_options (&opts, format);
-
 	  /* print memory to our uiout file and set the table's variable */
-	  print_scalar_formatted (mptr, val_type, &opts, asize, &stb);
+	  format_memory_cell (mptr, val_type, asize, format, &stb);
 
 	  /* See comments above on max_*_len */
 	  if (max_val_len == 0)
@@ -2601,16 +4225,8 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
 
 	  if (aschar)
 	    {
-	      for (j = 0; j < size; j++)
-		{
-		  if (isprint (*cptr))
-		    *bptr++ = *cptr++;
-		  else
-		    {
-		      *bptr++ = aschar;
-		      cptr++;;
-		    }
-		}
+	      bptr += format_memory_ascii (cptr, size, aschar, bptr);
+	      cptr += size;
 	    }
 	}
       Tcl_SetVar2 (interp, "data", index, stb.data (), 0);
@@ -2641,217 +4257,1508 @@ gdb_update_mem (ClientData clientData, Tcl_Interp *interp,
   return TCL_OK;
 #undef INDEX
 }
-
 
-/* This implements the tcl command "gdb_loadfile"
- * It loads a c source file into a text widget.
- *
- * Tcl Arguments:
- *    widget: the name of the text widget to fill
- *    filename: the name of the file to load
- *    linenumbers: A boolean indicating whether or not to display line numbers.
- * Tcl Result:
- *
- */
+/* This implements the "-binary" form of gdb_update_mem: read NBYTES
+   of target memory at ADDR and return them untouched as a Tcl byte
+   array.  No table variable is involved: the caller formats the cells
+   it shows with gdb_format_mem.  The Memory window gets its cells from
+   gdb_memview instead; this is the fallback for tables or scripts
+   without a native cell provider.  */
 
-/* In this routine, we will build up a "line table", i.e. a
- * table of bits showing which lines in the source file are executible.
- * LTABLE_SIZE is the number of bytes to allocate for the line table.
- *
- * Its size limits the maximum number of lines
- * in a file to 8 * LTABLE_SIZE.  This memory is freed after
- * the file is loaded, so it is OK to make this very large.
- * Additional memory will be allocated if needed. */
-#define LTABLE_SIZE 20000
 static int
-gdb_loadfile (ClientData clientData, Tcl_Interp *interp, int objc,
-	      Tcl_Obj *CONST objv[])
+gdb_update_mem_binary (Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[])
 {
-  const char *file;
-  char *widget;
-  int linenumbers, ln, lnum, ltable_size;
-  FILE *fp;
-  char *ltable;
-  struct symtab *symtab;
-  struct linetable_entry *le;
-  long mtime = 0;
-  struct stat st;
-  int llen;
-  char inputline[10000];
-  char line[10000], line_num_buf[18];
-  int found_carriage_return = 1;
-  const char *text_argv[9];
-  Tcl_CmdInfo text_cmd;
+  CORE_ADDR addr;
+  int nbytes, rnum;
+  std::vector<gdb_byte> mbuf;
 
   if (objc != 4)
     {
-      Tcl_WrongNumArgs(interp, 1, objv, "widget filename linenumbers");
+      Tcl_WrongNumArgs (interp, 1, objv, "-binary addr bytes");
       return TCL_ERROR;
     }
 
-  widget = Tcl_GetStringFromObj (objv[1], NULL);
-  if ( Tk_NameToWindow (interp, widget, Tk_MainWindow (interp)) == NULL)
-    {
-      return TCL_ERROR;
-    }
+  addr = string_to_core_addr (Tcl_GetStringFromObj (objv[2], NULL));
 
-  if (!Tcl_GetCommandInfo (interp, widget, &text_cmd))
+  if (Tcl_GetIntFromObj (interp, objv[3], &nbytes) != TCL_OK)
+    return TCL_ERROR;
+  else if (nbytes <= 0)
     {
-      gdbtk_set_result (interp, "Can't get widget command info");
+      gdbtk_set_result (interp, "Invalid number of bytes, must be > 0");
       return TCL_ERROR;
     }
 
-  file  = Tcl_GetStringFromObj (objv[2], NULL);
-  Tcl_GetBooleanFromObj (interp, objv[3], &linenumbers);
-
-  symtab = lookup_symtab (file);
-  if (!symtab)
+  try
     {
-      gdbtk_set_result (interp, "File not found in symtab");
-      return TCL_ERROR;
+      mbuf.resize (nbytes, 0);
     }
-
-  file = symtab_to_filename ( symtab );
-  if ((fp = fopen ( file, "r" )) == NULL)
+  catch (...)
     {
-      gdbtk_set_result (interp, "Can't open file for reading");
+      gdbtk_set_result (interp, "Out of memory.");
       return TCL_ERROR;
     }
 
-  if (stat (file, &st) < 0)
-    {
-      try
-        {
-          perror_with_name_wrapper ((PTR) "gdbtk: get time stamp");
-        }
-      catch (const gdb_exception &ex)
-        {
-          exception_print (gdb_stderr, ex);
-        }
+  /* Unreadable memory gives an empty block, whose cells gdb_format_mem
+     shows as "N/A", as gdb_memview does.  */
+  rnum = memory_cache.read (addr, mbuf.data (), nbytes);
+  Tcl_SetByteArrayObj (result_ptr->obj_ptr, mbuf.data (), std::max (rnum, 0));
+  return TCL_OK;
+}
+
+/* This implements the Tcl command 'gdb_format_mem', which formats
+ * a single memory window cell out of a byte array returned by
+ * "gdb_update_mem -binary".
+ *
+ * Arguments:
+ *   gdb_format_mem bytes offset format size
+ *   gdb_format_mem -ascii bytes offset count ascii_char
+ *
+ *   bytes: the raw memory block
+ *   offset: offset of the cell within the block
+ *   format: a char indicating format
+ *   size: size of the cell; 1, 2, 4 or 8 bytes
+ *   count: number of bytes to dump as ASCII
+ *   ascii_char: character used for unprintable bytes
+ *
+ * Return:
+ * the formatted cell.  Bytes past the end of the block show as "N/A"
+ * (or 'X' in ASCII dumps), just like gdb_update_mem does.  */
+
+static int
+gdb_format_mem (ClientData clientData, Tcl_Interp *interp,
+		int objc, Tcl_Obj *CONST objv[])
+{
+  gdb_byte *data;
+  int len, offset, size, ascii;
+  char format, asize;
+
+  ascii = objc > 1 && strcmp (Tcl_GetStringFromObj (objv[1], NULL),
+			      "-ascii") == 0;
+
+  if (objc != 5 + ascii)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv,
+			"?-ascii? bytes offset format|count size|ascii_char");
+      return TCL_ERROR;
+    }
+
+  objv += ascii;
+  data = Tcl_GetByteArrayFromObj (objv[1], &len);
+
+  if (Tcl_GetIntFromObj (interp, objv[2], &offset) != TCL_OK)
+    return TCL_ERROR;
+  else if (offset < 0)
+    {
+      gdbtk_set_result (interp, "Invalid offset, must be >= 0");
       return TCL_ERROR;
     }
 
-  if (symtab && SYMTAB_OBJFILE (symtab) && SYMTAB_OBJFILE (symtab)->obfd)
-    mtime = bfd_get_mtime (SYMTAB_OBJFILE (symtab)->obfd);
-  else if (exec_bfd)
-    mtime = bfd_get_mtime(exec_bfd);
+  if (ascii)
+    {
+      char buff[130];
+      int count, avail;
+
+      if (Tcl_GetIntFromObj (interp, objv[3], &count) != TCL_OK)
+	return TCL_ERROR;
+      else if (count <= 0 || count >= (int) sizeof (buff))
+	{
+	  gdbtk_set_result (interp, "Invalid count, must be > 0 and < %d",
+			    (int) sizeof (buff));
+	  return TCL_ERROR;
+	}
+
+      avail = offset < len ? std::min (count, len - offset) : 0;
+      format_memory_ascii (data + offset, avail,
+			   *Tcl_GetStringFromObj (objv[4], NULL), buff);
+      memset (buff + avail, 'X', count - avail);
+      buff[count] = '\0';
+      Tcl_SetStringObj (result_ptr->obj_ptr, buff, count);
+      return TCL_OK;
+    }
+
+  format = *(Tcl_GetStringFromObj (objv[3], NULL));
+
+  if (Tcl_GetIntFromObj (interp, objv[4], &size) != TCL_OK)
+    return TCL_ERROR;
+  else if (size <= 0)
+    {
+      gdbtk_set_result (interp, "Invalid size, must be > 0");
+      return TCL_ERROR;
+    }
+
+  if (offset >= len || size > len - offset)
+    Tcl_SetStringObj (result_ptr->obj_ptr, "N/A", -1);
+  else
+    {
+      string_file stb;
+      struct type *val_type = memory_cell_type (size, &asize);
+
+      format_memory_cell (data + offset, val_type, asize, format, &stb);
+      Tcl_SetStringObj (result_ptr->obj_ptr, stb.data (), stb.size ());
+    }
+
+  return TCL_OK;
+}
+
+/* Return the integer type used to print memory cells of SIZE bytes and
+   store the matching "x" command size letter in *ASIZE.  */
+
+static struct type *
+memory_cell_type (int size, char *asize)
+{
+  struct gdbarch *gdbarch = get_current_arch ();
+
+  switch (size)
+    {
+    case 2:
+      *asize = 'h';
+      return builtin_type (gdbarch)->builtin_int16;
+    case 4:
+      *asize = 'w';
+      return builtin_type (gdbarch)->builtin_int32;
+    case 8:
+      *asize = 'g';
+      return builtin_type (gdbarch)->builtin_int64;
+    default:
+      *asize = 'b';
+      return builtin_type (gdbarch)->builtin_int8;
+    }
+}
+
+/* Print the memory cell at DATA in FORMAT to STB.  */
+
+static void
+format_memory_cell (const gdb_byte *data, struct type *val_type,
+		    char asize, char format, string_file *stb)
+{
+  struct value_print_options opts;
+
+  get_formatted_print_options (&opts, format);
+  print_scalar_formatted (data, val_type, &opts, asize, stb);
+}
+
+/* Dump COUNT bytes at DATA as characters into BUF, replacing unprintable
+   ones by ASCHAR.  BUF is not NUL-terminated.  Returns COUNT.  */
+
+static int
+format_memory_ascii (const gdb_byte *data, int count, char aschar, char *buf)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    buf[i] = isprint (data[i]) ? data[i] : aschar;
+
+  return count;
+}
+
+/* Copy LEN bytes of target memory at ADDR into BUF, reading the pages
+   not yet cached.  Returns the number of bytes copied, which is less
+   than LEN if the memory past them cannot be read.  */
+
+int
+gdbtk_mem_cache::read (CORE_ADDR addr, gdb_byte *buf, int len)
+{
+  int done = 0;
+
+  while (done < len)
+    {
+      CORE_ADDR base = addr & ~((CORE_ADDR) GDBTK_MEM_PAGE_SIZE - 1);
+      int offset = addr - base;
+      int count = std::min (len - done, GDBTK_MEM_PAGE_SIZE - offset);
+      auto it = m_pages.find (base);
+
+      if (it == m_pages.end ())
+	{
+	  /* Fetch this page and the missing ones following it that the
+	     request spans, with a single target read.  */
+	  int npages = 1;
+
+	  while (npages < GDBTK_MEM_FILL_PAGES
+		 && (LONGEST) npages * GDBTK_MEM_PAGE_SIZE
+		    < offset + len - done
+		 && (m_pages.find (base + npages * GDBTK_MEM_PAGE_SIZE)
+		     == m_pages.end ()))
+	    npages++;
+
+	  fill (base, npages);
+	  it = m_pages.find (base);
+	}
+
+      const page *p = it->second.get ();
+
+      if (offset >= p->len)
+	{
+	  /* The page start is unreadable, but ADDR may still be: read it
+	     straight from the target, without caching.  */
+	  LONGEST rnum = target_read (current_top_target (),
+				      TARGET_OBJECT_MEMORY, NULL,
+				      buf + done, addr, count);
+
+	  if (rnum > 0)
+	    done += rnum;
+	  break;
+	}
+
+      count = std::min (count, p->len - offset);
+      memcpy (buf + done, p->data + offset, count);
+      done += count;
+      addr += count;
+
+      if (p->len < GDBTK_MEM_PAGE_SIZE)
+	break;
+    }
+
+  return done;
+}
+
+/* Read NPAGES pages starting at BASE from the target into the cache.
+   The pages past the first unreadable byte are not cached.  */
+
+void
+gdbtk_mem_cache::fill (CORE_ADDR base, int npages)
+{
+  std::vector<gdb_byte> buf (npages * GDBTK_MEM_PAGE_SIZE);
+  LONGEST rnum;
+  int i;
+
+  if (m_pages.size () + npages > GDBTK_MEM_CACHE_PAGES)
+    flush ();
+
+  rnum = target_read (current_top_target (), TARGET_OBJECT_MEMORY, NULL,
+		      buf.data (), base, buf.size ());
+  if (rnum < 0)
+    rnum = 0;
+
+  for (i = 0; i < npages; i++)
+    {
+      std::unique_ptr<page> p (new page);
+      LONGEST left = rnum - (LONGEST) i * GDBTK_MEM_PAGE_SIZE;
+
+      p->len = std::max<LONGEST> (0, std::min<LONGEST> (left,
+							 GDBTK_MEM_PAGE_SIZE));
+      memcpy (p->data, buf.data () + i * GDBTK_MEM_PAGE_SIZE, p->len);
+      m_pages[base + i * GDBTK_MEM_PAGE_SIZE] = std::move (p);
+
+      if (left < GDBTK_MEM_PAGE_SIZE)
+	break;
+    }
+}
+
+/* Update the cached copy of the LEN bytes at ADDR, which were just
+   written to the target from BUF.  */
+
+void
+gdbtk_mem_cache::write (CORE_ADDR addr, const gdb_byte *buf, int len)
+{
+  while (len > 0)
+    {
+      CORE_ADDR base = addr & ~((CORE_ADDR) GDBTK_MEM_PAGE_SIZE - 1);
+      int offset = addr - base;
+      int count = std::min (len, GDBTK_MEM_PAGE_SIZE - offset);
+      auto it = m_pages.find (base);
+
+      if (it != m_pages.end () && offset < it->second->len)
+	memcpy (it->second->data + offset, buf,
+		std::min (count, it->second->len - offset));
+
+      addr += count;
+      buf += count;
+      len -= count;
+    }
+}
+
+/* Drop the cached pages which overlap the LEN bytes at ADDR.  */
+
+void
+gdbtk_mem_cache::invalidate (CORE_ADDR addr, LONGEST len)
+{
+  CORE_ADDR base = addr & ~((CORE_ADDR) GDBTK_MEM_PAGE_SIZE - 1);
+  LONGEST npages;
+
+  if (len <= 0)
+    return;
+
+  npages = (addr - base + len - 1) / GDBTK_MEM_PAGE_SIZE + 1;
+  if (npages >= (LONGEST) m_pages.size ())
+    {
+      /* Cheaper to look at every cached page.  */
+      for (auto it = m_pages.begin (); it != m_pages.end (); )
+	if (it->first - base < (CORE_ADDR) npages * GDBTK_MEM_PAGE_SIZE)
+	  it = m_pages.erase (it);
+	else
+	  ++it;
+      return;
+    }
+
+  for (; npages > 0; npages--, base += GDBTK_MEM_PAGE_SIZE)
+    m_pages.erase (base);
+}
+
+/* Discard the whole gdbtk memory cache.  This is called whenever the
+   target memory may have changed behind our back: when the target
+   stops, the current trace frame changes, files are loaded...  */
+
+void
+gdbtk_memory_cache_flush (void)
+{
+  memory_cache.flush ();
+}
+
+/* Discard the part of the gdbtk memory cache which overlaps the LEN
+   bytes at ADDR.  */
+
+void
+gdbtk_memory_cache_invalidate (CORE_ADDR addr, LONGEST len)
+{
+  memory_cache.invalidate (addr, len);
+}
+
+/* This implements the Tcl command 'gdb_memview', which creates the
+ * native cell provider of a memory window table.
+ *
+ * Arguments:
+ *   gdb_memview create ?name? ?option value ...?
+ *
+ *   name: name of the object command to create.  One is generated if
+ *         not given.
+ *   options: see "configure" below.
+ *
+ * Return:
+ * the name of the new object command.  Its subcommands are:
+ *
+ *   cell row col ?set? ?value?
+ *     Return the contents of table cell ROW,COL, formatting it from
+ *     cached target memory.  Row -1 holds the column titles and
+ *     column -1 the addresses.  Meant to be the table's -command, as in
+ *     "-command {NAME cell %r %c %i %s}": when SET is true, VALUE is an
+ *     edit which is just accepted, so that the table keeps it until the
+ *     memory window commits it.
+ *   configure ?-addr addr? ?-nbytes n? ?-format f? ?-size n?
+ *             ?-bpr n? ?-ascii char?
+ *     Set the view parameters.  An empty ASCII char removes the ASCII
+ *     column.
+ *   refresh
+ *     Check the start address is readable, and forget the contents
+ *     of the rows fetched so far, as the table is about to fetch them
+ *     again.
+ *     Return the list {border_col_width data_col_width ascii_col_width},
+ *     as gdb_update_mem does.
+ *   changes
+ *     Return the cells of the rows fetched by the table which changed
+ *     since they were fetched or last reported, as a list of
+ *     alternating "row,col" indices and new values which can be passed
+ *     to the table's "set" subcommand.
+ *   delete
+ *     Delete the object command.
+ *
+ * Only the cells the table asks for are read and formatted, so the
+ * cost of a refresh or a scroll does not depend on the dump size.
+ * Memory comes from the gdbtk memory cache, which the hooks keep in
+ * sync with the target.  */
+
+static int
+gdb_memview (ClientData clientData, Tcl_Interp *interp,
+	     int objc, Tcl_Obj *CONST objv[])
+{
+  static int memview_count = 0;
+  struct gdbtk_memview *view;
+  std::string name;
+
+  if (objc < 2 || strcmp (Tcl_GetStringFromObj (objv[1], NULL), "create"))
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "create ?name? ?option value ...?");
+      return TCL_ERROR;
+    }
+
+  objc -= 2;
+  objv += 2;
+
+  if (objc && *Tcl_GetStringFromObj (objv[0], NULL) != '-')
+    {
+      name = Tcl_GetStringFromObj (objv[0], NULL);
+      objc--;
+      objv++;
+    }
+  else
+    name = string_printf ("memview%d", ++memview_count);
+
+  view = new gdbtk_memview;
+  if (memview_configure (interp, view, objc, objv) != TCL_OK)
+    {
+      delete view;
+      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  Tcl_CreateObjCommand (interp, name.c_str (), memview_obj_command,
+			(ClientData) view, memview_delete);
+  Tcl_SetStringObj (result_ptr->obj_ptr, name.c_str (), -1);
+  return TCL_OK;
+}
+
+/* This function implements the object command of a memory view.
+   See gdb_memview for the subcommands.  */
+
+static int
+memview_obj_command (ClientData clientData, Tcl_Interp *interp,
+		     int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *commands[] =
+    {"cell", "configure", "refresh", "changes", "delete", NULL};
+  enum commands_enum
+    {
+      MEMVIEW_CELL, MEMVIEW_CONFIGURE, MEMVIEW_REFRESH, MEMVIEW_CHANGES,
+      MEMVIEW_DELETE
+    };
+  struct gdbtk_memview *view = (struct gdbtk_memview *) clientData;
+  int index, result = TCL_OK;
+
+  if (objc < 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "option ?arg...?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], commands, "options", 0,
+			   &index) != TCL_OK)
+    return TCL_ERROR;
+
+  try
+    {
+      switch ((enum commands_enum) index)
+	{
+	case MEMVIEW_CELL:
+	  {
+	    int row, col, set = 0;
+
+	    if (objc < 4 || objc > 6)
+	      {
+		Tcl_WrongNumArgs (interp, 2, objv, "row col ?set? ?value?");
+		return TCL_ERROR;
+	      }
+	    if (Tcl_GetIntFromObj (interp, objv[2], &row) != TCL_OK
+		|| Tcl_GetIntFromObj (interp, objv[3], &col) != TCL_OK
+		|| (objc > 4
+		    && Tcl_GetBooleanFromObj (interp, objv[4], &set) != TCL_OK))
+	      return TCL_ERROR;
+
+	    if (set)
+	      Tcl_SetObjResult (interp, objc > 5 ? objv[5] : Tcl_NewObj ());
+	    else
+	      {
+		Tcl_SetObjResult (interp, memview_cell (view, row, col));
+		if (row >= 0 && !running_now
+		    && view->rows.find (row) == view->rows.end ()
+		    && (!view->nbytes
+			|| (LONGEST) row * view->bpr < view->nbytes))
+		  memview_read_row (view, row, &view->rows[row]);
+	      }
+	  }
+	  break;
+
+	case MEMVIEW_CONFIGURE:
+	  result = memview_configure (interp, view, objc - 2, objv + 2);
+	  break;
+
+	case MEMVIEW_REFRESH:
+	  {
+	    Tcl_Obj *widths[3];
+	    gdb_byte byte;
+
+	    if (memory_cache.read (view->addr, &byte, 1) != 1)
+	      {
+		gdbtk_set_result (interp, "Unable to read memory.");
+		return TCL_ERROR;
+	      }
+
+	    widths[0] =
+	      Tcl_NewIntObj (strlen (core_addr_to_string (view->addr)) + 1);
+	    widths[1] = memview_cell (view, 0, 0);
+	    Tcl_SetIntObj (widths[1], Tcl_GetCharLength (widths[1]) + 1);
+	    widths[2] = Tcl_NewIntObj (view->aschar ? view->bpr + 1 : 1);
+	    Tcl_SetObjResult (interp, Tcl_NewListObj (3, widths));
+
+	    /* The table is about to fetch its cells again.  */
+	    view->rows.clear ();
+	  }
+	  break;
+
+	case MEMVIEW_CHANGES:
+	  Tcl_SetObjResult (interp, memview_changes (view));
+	  break;
+
+	case MEMVIEW_DELETE:
+	  Tcl_DeleteCommand (interp, Tcl_GetStringFromObj (objv[0], NULL));
+	  break;
+	}
+    }
+  catch (const gdb_exception &except)
+    {
+      gdbtk_set_result (interp, "%s", except.what ());
+      result = TCL_ERROR;
+    }
+
+  return result;
+}
+
+/* Tcl delete proc of memory view object commands.  */
+
+static void
+memview_delete (ClientData clientData)
+{
+  delete (struct gdbtk_memview *) clientData;
+}
+
+/* Parse the configure options of a memory view.  */
+
+static int
+memview_configure (Tcl_Interp *interp, struct gdbtk_memview *view,
+		   int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *options[] =
+    {"-addr", "-nbytes", "-format", "-size", "-bpr", "-ascii", NULL};
+  enum options_enum
+    {
+      OPT_ADDR, OPT_NBYTES, OPT_FORMAT, OPT_SIZE, OPT_BPR, OPT_ASCII
+    };
+  int index, value;
+
+  for (; objc > 0; objc -= 2, objv += 2)
+    {
+      if (Tcl_GetIndexFromObj (interp, objv[0], options, "option", 0,
+			       &index) != TCL_OK)
+	return TCL_ERROR;
+
+      if (objc < 2)
+	{
+	  gdbtk_set_result (interp, "missing value for %s",
+			    Tcl_GetStringFromObj (objv[0], NULL));
+	  return TCL_ERROR;
+	}
+
+      switch ((enum options_enum) index)
+	{
+	case OPT_ADDR:
+	  view->addr = string_to_core_addr (Tcl_GetStringFromObj (objv[1],
+								  NULL));
+	  break;
+
+	case OPT_FORMAT:
+	  view->format = *Tcl_GetStringFromObj (objv[1], NULL);
+	  break;
+
+	case OPT_ASCII:
+	  view->aschar = *Tcl_GetStringFromObj (objv[1], NULL);
+	  break;
+
+	default:
+	  if (Tcl_GetIntFromObj (interp, objv[1], &value) != TCL_OK)
+	    return TCL_ERROR;
+	  if (value < 0 || (value == 0 && index != OPT_NBYTES))
+	    {
+	      gdbtk_set_result (interp, "Invalid %s, must be > 0",
+				Tcl_GetStringFromObj (objv[0], NULL) + 1);
+	      return TCL_ERROR;
+	    }
+	  if (index == OPT_NBYTES)
+	    view->nbytes = value;
+	  else if (index == OPT_SIZE)
+	    view->size = value;
+	  else
+	    view->bpr = value;
+	  break;
+	}
+    }
+
+  view->rows.clear ();
+  return TCL_OK;
+}
+
+/* Return a new object holding the contents of cell ROW,COL of VIEW.  */
+
+static Tcl_Obj *
+memview_cell (struct gdbtk_memview *view, int row, int col)
+{
+  int ncols = view->bpr / view->size;
+  LONGEST offset;
+
+  if (row < 0)
+    {
+      /* Column titles. */
+      if (col < 0)
+	return Tcl_NewObj ();
+      else if (col < ncols)
+	return Tcl_NewStringObj (string_printf (" %X",
+						col * view->size).c_str (),
+				 -1);
+      return Tcl_NewStringObj (view->aschar ? "ASCII" : "", -1);
+    }
+
+  offset = (LONGEST) row * view->bpr;
+  if ((view->nbytes && offset >= view->nbytes) || running_now)
+    return Tcl_NewObj ();
+
+  if (col < 0)
+    return Tcl_NewStringObj (core_addr_to_string (view->addr + offset), -1);
+
+  if (col < ncols)
+    {
+      std::vector<gdb_byte> data (view->size);
+      char asize;
+      struct type *val_type = memory_cell_type (view->size, &asize);
+
+      offset += col * view->size;
+      if (memory_cache.read (view->addr + offset, data.data (), view->size)
+	  < view->size)
+	return Tcl_NewStringObj ("N/A", -1);
+
+      string_file stb;
+      format_memory_cell (data.data (), val_type, asize, view->format, &stb);
+      return Tcl_NewStringObj (stb.data (), stb.size ());
+    }
+
+  if (!view->aschar)
+    return Tcl_NewObj ();
+
+  std::vector<gdb_byte> data (view->bpr);
+  std::string buff (view->bpr, 'X');
+  int avail = memory_cache.read (view->addr + offset, data.data (),
+				 view->bpr);
+
+  format_memory_ascii (data.data (), avail, view->aschar, &buff[0]);
+  return Tcl_NewStringObj (buff.data (), buff.size ());
+}
+
+/* Read the readable prefix of row ROW of the dump of VIEW into BUF.  */
+
+static void
+memview_read_row (struct gdbtk_memview *view, int row,
+		  std::vector<gdb_byte> *buf)
+{
+  LONGEST offset = (LONGEST) row * view->bpr;
+  int len = view->bpr;
+
+  if (view->nbytes)
+    len = std::min<LONGEST> (len, view->nbytes - offset);
+
+  buf->resize (len);
+  buf->resize (memory_cache.read (view->addr + offset, buf->data (), len));
+}
+
+/* Return true if the LEN bytes at OFFSET differ between the rows OLD
+   and NOW, or are readable in only one of them.  */
+
+static bool
+memview_bytes_differ (const std::vector<gdb_byte> &old,
+		      const std::vector<gdb_byte> &now, int offset, int len)
+{
+  bool in_old = offset + len <= (int) old.size ();
+  bool in_now = offset + len <= (int) now.size ();
+
+  if (in_old != in_now)
+    return true;
+  return in_now && memcmp (old.data () + offset, now.data () + offset, len);
+}
+
+/* Return the list of "row,col" value pairs of the cells of VIEW which
+   changed since they were last fetched or reported, and remember their
+   new contents.  Only the rows the table has fetched are looked at, so
+   the cost does not depend on the dump size.  */
+
+static Tcl_Obj *
+memview_changes (struct gdbtk_memview *view)
+{
+  Tcl_Obj *result = Tcl_NewListObj (0, NULL);
+  std::vector<gdb_byte> now;
+  int ncols = view->bpr / view->size;
+  int col;
+
+  if (running_now)
+    return result;
+
+  for (auto &it : view->rows)
+    {
+      int row = it.first;
+      bool row_changed = false;
+
+      memview_read_row (view, row, &now);
+
+      for (col = 0; col < ncols; col++)
+	if (memview_bytes_differ (it.second, now, col * view->size,
+				  view->size))
+	  {
+	    std::string index = string_printf ("%d,%d", row, col);
+
+	    Tcl_ListObjAppendElement (NULL, result,
+				      Tcl_NewStringObj (index.c_str (), -1));
+	    Tcl_ListObjAppendElement (NULL, result,
+				      memview_cell (view, row, col));
+	    row_changed = true;
+	  }
+
+      if (row_changed && view->aschar)
+	{
+	  std::string index = string_printf ("%d,%d", row, ncols);
+
+	  Tcl_ListObjAppendElement (NULL, result,
+				    Tcl_NewStringObj (index.c_str (), -1));
+	  Tcl_ListObjAppendElement (NULL, result,
+				    memview_cell (view, row, ncols));
+	}
+
+      it.second.swap (now);
+    }
+
+  return result;
+}
+
+
+/* The contents of a file, mapped in memory if possible, else read
+   in a single buffer.  */
+
+class gdbtk_file_contents
+{
+public:
+  gdbtk_file_contents () = default;
+  ~gdbtk_file_contents ();
+
+  DISABLE_COPY_AND_ASSIGN (gdbtk_file_contents);
+
+  bool load (int fd, size_t size);
+
+  const char *data () const
+  {
+    return m_data;
+  }
+
+  size_t size () const
+  {
+    return m_size;
+  }
+
+private:
+  const char *m_data = "";
+  size_t m_size = 0;
+  bool m_mapped = false;
+  std::string m_buffer;
+};
+
+gdbtk_file_contents::~gdbtk_file_contents ()
+{
+#ifdef HAVE_MMAP
+  if (m_mapped)
+    munmap ((void *) m_data, m_size);
+#endif
+}
+
+/* Read SIZE bytes at OFFSET of the file open on FD into BUF.  Return
+   false on error.  */
+
+static bool
+read_file_range (int fd, off_t offset, size_t size, char *buf)
+{
+  size_t done = 0;
+
+  if (lseek (fd, offset, SEEK_SET) != offset)
+    return false;
+
+  while (done < size)
+    {
+      ssize_t n = read (fd, buf + done, size - done);
+
+      if (n <= 0)
+	return false;
+      done += n;
+    }
+  return true;
+}
+
+/* Load the SIZE bytes of the file open on FD.  Return false on
+   error.  */
+
+bool
+gdbtk_file_contents::load (int fd, size_t size)
+{
+  if (size == 0)
+    return true;
+
+#ifdef HAVE_MMAP
+  void *addr = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  if (addr != MAP_FAILED)
+    {
+      m_data = (const char *) addr;
+      m_size = size;
+      m_mapped = true;
+      return true;
+    }
+#endif
+
+  m_buffer.resize (size);
+  if (!read_file_range (fd, 0, size, &m_buffer[0]))
+    return false;
+  m_data = m_buffer.data ();
+  m_size = size;
+  return true;
+}
+
+/* A source file loaded by gdb_loadfile, with the offsets of its lines
+   (as in symtab->line_charpos).  Lines are only converted to UTF-8
+   when they are inserted in the text widget.  It is installed as a Tcl
+   object command by gdb_source.
+
+   The contents are only kept while gdb_loadfile runs.  Afterwards,
+   the lines asked for are read again from the file, provided it has
+   not changed since it was indexed.  */
+
+struct gdbtk_source_file
+{
+  bool load (const char *filename, int fd, const struct stat &st);
+  void release ();
+
+  int lines () const
+  {
+    return line_starts.empty () ? 0 : line_starts.size () - 1;
+  }
+
+  bool read (size_t from, size_t to, std::string &buf) const;
+  bool convert (int first, int last, const char *lead, const char *trail,
+		std::string &text, std::vector<size_t> &offsets) const;
+  bool find (const char *string, int line, bool forwards, int *found) const;
+
+  std::unique_ptr<gdbtk_file_contents> contents;
+
+  /* Offset of each line, followed by the size of the file.  */
+  std::vector<size_t> line_starts;
+
+  /* The file, and its size and modification time when it was
+     indexed.  */
+  std::string filename;
+  off_t size = 0;
+  time_t mtime = 0;
+
+  /* The text widget the file was loaded in.  */
+  std::string widget;
+};
+
+/* Load FILENAME, open on FD and of status ST, and index its lines.
+   Return false on error.  */
+
+bool
+gdbtk_source_file::load (const char *filename, int fd, const struct stat &st)
+{
+  const char *data, *p, *end;
+
+  contents.reset (new gdbtk_file_contents);
+  line_starts.clear ();
+  this->filename = filename;
+  size = st.st_size;
+  mtime = st.st_mtime;
+  if (!contents->load (fd, st.st_size))
+    return false;
+
+  data = contents->data ();
+  end = data + contents->size ();
+  for (p = data; p < end; )
+    {
+      const char *eol = (const char *) memchr (p, '\n', end - p);
+
+      line_starts.push_back (p - data);
+      p = eol != NULL ? eol + 1 : end;
+    }
+  line_starts.push_back (end - data);
+  return true;
+}
+
+/* Forget the contents of the file, keeping the offsets of its lines.  */
+
+void
+gdbtk_source_file::release ()
+{
+  contents.reset ();
+}
+
+/* Set BUF to the bytes FROM to TO of the file.  Return false if they
+   cannot be read, or if the file changed since it was indexed.  */
+
+bool
+gdbtk_source_file::read (size_t from, size_t to, std::string &buf) const
+{
+  struct stat st;
+  bool ok;
+  int fd;
+
+  if (contents != NULL)
+    {
+      buf.assign (contents->data () + from, to - from);
+      return true;
+    }
+
+  fd = open (filename.c_str (), O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return false;
 
-  if (mtime && mtime < st.st_mtime)
+  ok = (fstat (fd, &st) == 0 && st.st_size == size && st.st_mtime == mtime);
+  if (ok)
     {
-      gdbtk_ignorable_warning("file_times",\
-			      "Source file is more recent than executable.\n");
+      buf.resize (to - from);
+      ok = read_file_range (fd, from, to - from, &buf[0]);
     }
+  close (fd);
+  return ok;
+}
 
+/* Append the text of lines FIRST to LAST to TEXT, each one between
+   LEAD and TRAIL (if it has a newline) and NUL-terminated, and their
+   offsets in TEXT to OFFSETS.  DOS style \r\n endings are stripped.
+   Return false if the lines cannot be read.  */
+
+bool
+gdbtk_source_file::convert (int first, int last, const char *lead,
+			    const char *trail, std::string &text,
+			    std::vector<size_t> &offsets) const
+{
+  Tcl_DString utf;
+  std::string raw;
+  const char *p, *end;
+  int ln;
+
+  if (!read (line_starts[first - 1], line_starts[last], raw))
+    return false;
+
+  /* Convert from system encoding to utf-8. This has the side effect
+     to map invalid characters in source encoding to a default value.  */
+  Tcl_DStringInit (&utf);
+  Tcl_ExternalToUtfDString (NULL, raw.data (), raw.size (), &utf);
+
+  p = Tcl_DStringValue (&utf);
+  end = p + Tcl_DStringLength (&utf);
+  for (ln = first; ln <= last; ln++)
+    {
+      const char *eol = (const char *) memchr (p, '\n', end - p);
+      size_t len = eol != NULL ? eol - p : end - p;
+
+      offsets.push_back (text.size ());
+      text += lead;
+      text.append (p, len > 0 && p[len - 1] == '\r' ? len - 1 : len);
+      if (eol != NULL)
+	text += trail;
+      text += '\0';
+      p += eol != NULL ? len + 1 : len;
+    }
+  Tcl_DStringFree (&utf);
+  return true;
+}
 
-  /* Source linenumbers don't appear to be in order, and a sort is */
-  /* too slow so the fastest solution is just to allocate a huge */
-  /* array and set the array entry for each linenumber */
+/* Set *FOUND to the nearest line containing STRING at or after LINE,
+   or at or before it if not FORWARDS, wrapping around the file, or to
+   0 if STRING is not found.  The file is read for the search only.
+   Return false if it cannot be read.  */
 
-  ltable_size = LTABLE_SIZE;
-  ltable = (char *)malloc (LTABLE_SIZE);
-  if (ltable == NULL)
+bool
+gdbtk_source_file::find (const char *string, int line, bool forwards,
+			 int *found) const
+{
+  Tcl_DString ext;
+  std::string text;
+  const char *data, *end, *s, *s_end, *match;
+
+  *found = 0;
+  if (lines () == 0 || *string == '\0')
+    return true;
+  line = std::max (1, std::min (line, lines ()));
+
+  if (!read (0, line_starts.back (), text))
+    return false;
+  data = text.data ();
+  end = data + text.size ();
+  Tcl_DStringInit (&ext);
+  s = Tcl_UtfToExternalDString (NULL, string, -1, &ext);
+  s_end = s + Tcl_DStringLength (&ext);
+
+  if (forwards)
     {
-      fclose (fp);
-      gdbtk_set_result (interp, "Out of memory.");
-      return TCL_ERROR;
+      match = std::search (data + line_starts[line - 1], end, s, s_end);
+      if (match == end)
+	match = std::search (data, end, s, s_end);
+    }
+  else
+    {
+      const char *to = data + line_starts[line];
+
+      match = std::find_end (data, to, s, s_end);
+      if (match == to)
+	match = std::find_end (data, end, s, s_end);
     }
+  Tcl_DStringFree (&ext);
+
+  if (match != end)
+    *found = std::upper_bound (line_starts.begin (), line_starts.end (),
+			       (size_t) (match - data))
+	     - line_starts.begin ();
+  return true;
+}
 
-  memset (ltable, 0, LTABLE_SIZE);
+/* This implements the Tcl command 'gdb_source', which creates the
+ * holder of a source file loaded lazily by gdb_loadfile.
+ *
+ * Arguments:
+ *   gdb_source create ?name?
+ *
+ *   name: name of the object command to create.  One is generated if
+ *         not given.
+ *
+ * Return:
+ * the name of the new object command, to pass to the -source option of
+ * gdb_loadfile.  Its subcommands are:
+ *
+ *   lines
+ *     Return the number of lines of the file.
+ *   fill first last
+ *     Insert the text of lines FIRST to LAST at the end of their lines
+ *     of the text widget.
+ *   find string line forwards|backwards
+ *     Return the nearest line at or after (or before) LINE containing
+ *     STRING, wrapping around the file, or 0 if there is none.
+ *   delete
+ *     Delete the object command.
+ *
+ * Only the offsets of the lines are kept: "fill" and "find" read the
+ * file again, and fail if it changed since it was loaded.  */
+
+static int
+gdb_source (ClientData clientData, Tcl_Interp *interp,
+	    int objc, Tcl_Obj *CONST objv[])
+{
+  static int source_count = 0;
+  std::string name;
 
-  if (SYMTAB_LINETABLE (symtab) && SYMTAB_LINETABLE (symtab)->nitems)
+  if (objc < 2 || objc > 3
+      || strcmp (Tcl_GetStringFromObj (objv[1], NULL), "create"))
     {
-      le = SYMTAB_LINETABLE (symtab)->item;
-      for (ln = SYMTAB_LINETABLE(symtab)->nitems ;ln > 0; ln--, le++)
-        {
-          lnum = le->line >> 3;
-          if (lnum >= ltable_size)
-            {
-              char *new_ltable;
-              new_ltable = (char *)realloc (ltable, ltable_size*2);
-              memset (new_ltable + ltable_size, 0, ltable_size);
-              ltable_size *= 2;
-              if (new_ltable == NULL)
-                {
-                  free (ltable);
-                  fclose (fp);
-		  gdbtk_set_result (interp, "Out of memory.");
-                  return TCL_ERROR;
-                }
-              ltable = new_ltable;
-            }
-          ltable[lnum] |= 1 << (le->line % 8);
-        }
+      Tcl_WrongNumArgs (interp, 1, objv, "create ?name?");
+      return TCL_ERROR;
     }
 
-  ln = 1;
+  if (objc == 3)
+    name = Tcl_GetStringFromObj (objv[2], NULL);
+  else
+    name = string_printf ("source%d", ++source_count);
+
+  Tcl_CreateObjCommand (interp, name.c_str (), source_obj_command,
+			(ClientData) new gdbtk_source_file, source_delete);
+  Tcl_SetStringObj (result_ptr->obj_ptr, name.c_str (), -1);
+  return TCL_OK;
+}
 
-  line[0] = '\t';
-  line_num_buf[1] = linenumbers? '\t': ' ';
-  line_num_buf[2] = '\0';
-  text_argv[0] = widget;
-  text_argv[1] = "insert";
-  text_argv[2] = "end";
-  text_argv[3] = line_num_buf;
-  text_argv[5] = line;
-  text_argv[6] = "source_tag";
-  text_argv[7] = NULL;
+/* This function implements the object command of a source file.
+   See gdb_source for the subcommands.  */
+
+static int
+source_obj_command (ClientData clientData, Tcl_Interp *interp,
+		    int objc, Tcl_Obj *CONST objv[])
+{
+  static const char *commands[] = {"lines", "fill", "find", "delete", NULL};
+  enum commands_enum
+    {
+      SOURCE_LINES, SOURCE_FILL, SOURCE_FIND, SOURCE_DELETE
+    };
+  struct gdbtk_source_file *source = (struct gdbtk_source_file *) clientData;
+  int cmd;
+
+  if (objc < 2)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "option ?arg...?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIndexFromObj (interp, objv[1], commands, "options", 0,
+			   &cmd) != TCL_OK)
+    return TCL_ERROR;
 
-  while (fgets (inputline, sizeof (inputline), fp))
+  switch ((enum commands_enum) cmd)
     {
-      llen = strlen(inputline);
+    case SOURCE_LINES:
+      Tcl_SetObjResult (interp, Tcl_NewIntObj (source->lines ()));
+      break;
+
+    case SOURCE_FILL:
+      {
+	Tcl_CmdInfo text_cmd;
+	std::string text;
+	std::vector<size_t> offsets;
+	const char *text_argv[6];
+	char index[40];
+	int first, last, ln;
+
+	if (objc != 4)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "first last");
+	    return TCL_ERROR;
+	  }
+	if (Tcl_GetIntFromObj (interp, objv[2], &first) != TCL_OK
+	    || Tcl_GetIntFromObj (interp, objv[3], &last) != TCL_OK)
+	  return TCL_ERROR;
+
+	first = std::max (first, 1);
+	last = std::min (last, source->lines ());
+	if (first > last)
+	  break;
+
+	if (!Tcl_GetCommandInfo (interp, source->widget.c_str (), &text_cmd))
+	  {
+	    Tcl_SetObjResult (interp,
+			      Tcl_NewStringObj ("Can't get widget command info",
+						-1));
+	    return TCL_ERROR;
+	  }
+
+	if (!source->convert (first, last, "", "", text, offsets))
+	  {
+	    Tcl_SetObjResult (interp,
+			      Tcl_NewStringObj ("Source file changed", -1));
+	    return TCL_ERROR;
+	  }
+
+	text_argv[0] = source->widget.c_str ();
+	text_argv[1] = "insert";
+	text_argv[2] = index;
+	text_argv[4] = "source_tag";
+	text_argv[5] = NULL;
+	for (ln = first; ln <= last; ln++)
+	  {
+	    text_argv[3] = text.c_str () + offsets[ln - first];
+	    if (*text_argv[3] == '\0')
+	      continue;
+	    xsnprintf (index, sizeof (index), "%d.0 lineend", ln);
+	    text_cmd.proc (text_cmd.clientData, interp, 5, text_argv);
+	  }
+	Tcl_ResetResult (interp);
+      }
+      break;
+
+    case SOURCE_FIND:
+      {
+	static const char *directions[] = {"forwards", "backwards", NULL};
+	int line, direction;
+
+	if (objc != 5)
+	  {
+	    Tcl_WrongNumArgs (interp, 2, objv, "string line direction");
+	    return TCL_ERROR;
+	  }
+	if (Tcl_GetIntFromObj (interp, objv[3], &line) != TCL_OK
+	    || Tcl_GetIndexFromObj (interp, objv[4], directions, "direction",
+				    0, &direction) != TCL_OK)
+	  return TCL_ERROR;
+
+	if (!source->find (Tcl_GetStringFromObj (objv[2], NULL), line,
+			   direction == 0, &line))
+	  {
+	    Tcl_SetObjResult (interp,
+			      Tcl_NewStringObj ("Source file changed", -1));
+	    return TCL_ERROR;
+	  }
+	Tcl_SetObjResult (interp, Tcl_NewIntObj (line));
+      }
+      break;
+
+    case SOURCE_DELETE:
+      Tcl_DeleteCommand (interp, Tcl_GetStringFromObj (objv[0], NULL));
+      break;
+    }
+
+  return TCL_OK;
+}
+
+/* Tcl delete proc of source file object commands.  */
+
+static void
+source_delete (ClientData clientData)
+{
+  delete (struct gdbtk_source_file *) clientData;
+}
+
+/* The executable lines of the symtabs, built from their line tables
+   as needed.  The cache is flushed whenever symbols are loaded or
+   freed.  */
+
+static std::unordered_map<struct symtab *, std::vector<bool>>
+  executable_lines_cache;
+
+/* Return the bitmap of the executable lines of SYMTAB, indexed by line
+   number.  It may be shorter than the file.  */
 
-      /* Look for DOS style \r\n endings, and if found,
-       * strip off the \r.  We assume (for the sake of
-       * speed) that ALL lines in the file have DOS endings,
-       * or none do.
-       */
+static const std::vector<bool> &
+symtab_executable_lines (struct symtab *symtab)
+{
+  auto it = executable_lines_cache.find (symtab);
+
+  if (it != executable_lines_cache.end ())
+    return it->second;
+
+  /* Source linenumbers don't appear to be in order, so just set the
+     bit of each linenumber.  */
+  std::vector<bool> &lines = executable_lines_cache[symtab];
+  struct linetable *l = SYMTAB_LINETABLE (symtab);
+
+  if (l != NULL)
+    {
+      int i;
 
-      if (found_carriage_return)
+      for (i = 0; i < l->nitems; i++)
 	{
-	  char *p = inputline + llen - 2;
-	  if (llen > 1 && *p == '\r')
-	    {
-	      *p = '\n';
-	       *(p + 1) = '\0';
-	       llen--;
-	    }
-	  else
-	    found_carriage_return = 0;
+	  int line = l->item[i].line;
+
+	  if (line <= 0)
+	    continue;
+	  if (line >= (int) lines.size ())
+	    lines.resize (line + 1);
+	  lines[line] = true;
 	}
+    }
+  return lines;
+}
+
+/* Discard the executable lines of the symtabs.  */
+
+void
+gdbtk_executable_lines_flush (void)
+{
+  executable_lines_cache.clear ();
+}
+
+/* This implements the Tcl command 'gdb_executable_lines'.
+ *
+ * Arguments:
+ *   gdb_executable_lines filename ?first last?
+ *
+ * Tcl Result:
+ *   the list of the executable lines of FILENAME, between FIRST and
+ *   LAST if given.
+ */
+
+static int
+gdb_executable_lines (ClientData clientData, Tcl_Interp *interp,
+		      int objc, Tcl_Obj *CONST objv[])
+{
+  struct symtab *symtab;
+  int first = 1, last = INT_MAX, line;
+
+  if (objc != 2 && objc != 4)
+    {
+      Tcl_WrongNumArgs (interp, 1, objv, "filename ?first last?");
+      return TCL_ERROR;
+    }
+
+  if (objc == 4
+      && (Tcl_GetIntFromObj (interp, objv[2], &first) != TCL_OK
+	  || Tcl_GetIntFromObj (interp, objv[3], &last) != TCL_OK))
+    {
+      result_ptr->flags |= GDBTK_IN_TCL_RESULT;
+      return TCL_ERROR;
+    }
+
+  symtab = lookup_symtab (Tcl_GetStringFromObj (objv[1], NULL));
+  if (!symtab)
+    {
+      gdbtk_set_result (interp, "File not found in symtab");
+      return TCL_ERROR;
+    }
+
+  const std::vector<bool> &lines = symtab_executable_lines (symtab);
+
+  Tcl_SetListObj (result_ptr->obj_ptr, 0, NULL);
+  last = std::min (last, (int) lines.size () - 1);
+  for (line = std::max (first, 1); line <= last; line++)
+    if (lines[line])
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				Tcl_NewIntObj (line));
+  return TCL_OK;
+}
+
+/* This implements the tcl command "gdb_loadfile"
+ * It loads a c source file into a text widget.
+ *
+ * Tcl Arguments:
+ *    -source obj: keep the file in the source object OBJ, created by
+ *                 gdb_source, and only insert the line numbers and
+ *                 break tags.  The text of the lines is inserted by
+ *                 "OBJ fill", as they are displayed.
+ *    widget: the name of the text widget to fill
+ *    filename: the name of the file to load
+ *    linenumbers: A boolean indicating whether or not to display line numbers.
+ * Tcl Result:
+ *
+ */
+
+/* Number of source lines inserted into the text widget at once.  */
+#define LOADFILE_BATCH_LINES 1000
+
+static int
+gdb_loadfile (ClientData clientData, Tcl_Interp *interp, int objc,
+	      Tcl_Obj *CONST objv[])
+{
+  const char *file;
+  char *widget;
+  int linenumbers, ln, nlines, first;
+  int fd;
+  struct symtab *symtab;
+  long mtime = 0;
+  struct stat st;
+  gdbtk_source_file local_source, *source = &local_source;
+  bool lazy = false;
+  std::string prefixes, lines;
+  std::vector<size_t> prefix_offsets, offsets;
+  std::vector<const char *> text_argv;
+  Tcl_CmdInfo text_cmd;
+
+  if (objc == 6
+      && strcmp (Tcl_GetStringFromObj (objv[1], NULL), "-source") == 0)
+    {
+      Tcl_CmdInfo info;
 
-      /* Convert from system encoding to utf-8. This has the side effect
-       * to map invalid characters in source encoding to a default value.
-       */
-      if (Tcl_ExternalToUtf (interp, NULL, inputline, llen, 0, NULL,
-			     line + 1, 9980, NULL, &llen, NULL) != TCL_OK)
+      if (!Tcl_GetCommandInfo (interp, Tcl_GetStringFromObj (objv[2], NULL),
+			       &info)
+	  || info.objProc != source_obj_command)
 	{
-	  free (ltable);
-	  fclose (fp);
-	  gdbtk_set_result (interp, "Conversion error.");
+	  gdbtk_set_result (interp, "Invalid source \"%s\".",
+			    Tcl_GetStringFromObj (objv[2], NULL));
 	  return TCL_ERROR;
 	}
-      line[llen + 1] = '\0';
+      source = (struct gdbtk_source_file *) info.objClientData;
+      lazy = true;
+      objc -= 2;
+      objv += 2;
+    }
+
+  if (objc != 4)
+    {
+      Tcl_WrongNumArgs(interp, 1, objv, "?-source obj? widget filename linenumbers");
+      return TCL_ERROR;
+    }
+
+  widget = Tcl_GetStringFromObj (objv[1], NULL);
+  if ( Tk_NameToWindow (interp, widget, Tk_MainWindow (interp)) == NULL)
+    {
+      return TCL_ERROR;
+    }
+
+  if (!Tcl_GetCommandInfo (interp, widget, &text_cmd))
+    {
+      gdbtk_set_result (interp, "Can't get widget command info");
+      return TCL_ERROR;
+    }
+
+  file  = Tcl_GetStringFromObj (objv[2], NULL);
+  Tcl_GetBooleanFromObj (interp, objv[3], &linenumbers);
+
+  symtab = lookup_symtab (file);
+  if (!symtab)
+    {
+      gdbtk_set_result (interp, "File not found in symtab");
+      return TCL_ERROR;
+    }
 
-      if (linenumbers)
-        sprintf (line_num_buf+2, "%d", ln);
+  file = symtab_to_filename ( symtab );
+  if ((fd = open (file, O_RDONLY | O_BINARY)) < 0)
+    {
+      gdbtk_set_result (interp, "Can't open file for reading");
+      return TCL_ERROR;
+    }
 
-      if (ltable[ln >> 3] & (1 << (ln % 8)))
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      try
         {
-	  line_num_buf[0] = '-';
-          text_argv[4] = "break_rgn_tag";
+          perror_with_name_wrapper ((PTR) "gdbtk: get time stamp");
         }
-      else
+      catch (const gdb_exception &ex)
         {
-	  line_num_buf[0] = ' ';
-          text_argv[4] = "";
+          exception_print (gdb_stderr, ex);
         }
+      return TCL_ERROR;
+    }
+
+  if (!source->load (file, fd, st))
+    {
+      close (fd);
+      source->release ();
+      gdbtk_set_result (interp, "Can't read file");
+      return TCL_ERROR;
+    }
+  close (fd);
+  source->widget = widget;
+
+  if (symtab && SYMTAB_OBJFILE (symtab) && SYMTAB_OBJFILE (symtab)->obfd)
+    mtime = bfd_get_mtime (SYMTAB_OBJFILE (symtab)->obfd);
+  else if (exec_bfd)
+    mtime = bfd_get_mtime(exec_bfd);
+
+  if (mtime && mtime < st.st_mtime)
+    {
+      gdbtk_ignorable_warning("file_times",\
+			      "Source file is more recent than executable.\n");
+    }
+
+  const std::vector<bool> &executable = symtab_executable_lines (symtab);
+
+  /* Insert the lines by batches.  Each line is made of a line number
+     prefix, with the break_rgn_tag if the line is executable, and of
+     the text of the line, which is left empty in lazy mode.  */
+
+  nlines = source->lines ();
+  for (first = 1; first <= nlines; first += LOADFILE_BATCH_LINES)
+    {
+      int last = std::min (first + LOADFILE_BATCH_LINES - 1, nlines);
+
+      prefixes.clear ();
+      prefix_offsets.clear ();
+      lines.clear ();
+      offsets.clear ();
+      if (!lazy)
+	source->convert (first, last, "\t", "\n", lines, offsets);
+
+      for (ln = first; ln <= last; ln++)
+	{
+	  prefix_offsets.push_back (prefixes.size ());
+	  prefixes += (ln < (int) executable.size () && executable[ln]
+		       ? '-' : ' ');
+	  prefixes += linenumbers ? '\t' : ' ';
+	  if (linenumbers)
+	    prefixes += std::to_string (ln);
+	  prefixes += '\0';
+	}
+
+      text_argv.clear ();
+      text_argv.push_back (widget);
+      text_argv.push_back ("insert");
+      text_argv.push_back ("end");
+      for (ln = first; ln <= last; ln++)
+	{
+	  const char *prefix = prefixes.c_str () + prefix_offsets[ln - first];
+
+	  text_argv.push_back (prefix);
+	  text_argv.push_back (*prefix == '-' ? "break_rgn_tag" : "");
+	  if (lazy)
+	    text_argv.push_back (ln < nlines
+				 || source->contents->data ()
+				    [source->contents->size () - 1] == '\n'
+				 ? "\t\n" : "\t");
+	  else
+	    text_argv.push_back (lines.c_str () + offsets[ln - first]);
+	  text_argv.push_back ("source_tag");
+	}
+      text_argv.push_back (NULL);
 
-      text_cmd.proc(text_cmd.clientData, interp, 7, text_argv);
-      ln++;
+      text_cmd.proc (text_cmd.clientData, interp, text_argv.size () - 1,
+		     text_argv.data ());
     }
 
-  free (ltable);
-  fclose (fp);
+  /* A source object outlives the call: it only keeps the offsets of
+     the lines.  */
+  source->release ();
   return TCL_OK;
 }
 
@@ -60,6 +60,8 @@
 #include <sys/time.h>
 
 #include <string.h>
+#include <algorithm>
+#include <map>
 #include "dis-asm.h"
 #include "gdbcmd.h"
 
@@ -94,9 +96,13 @@ static void gdbtk_pre_add_symbol (const char *);
 static void gdbtk_print_frame_info (struct symtab *, int, int, int);
 static void gdbtk_post_add_symbol (void);
 static void gdbtk_register_changed (struct frame_info *frame, int regno);
+static void gdbtk_memory_rewritten (void);
 static void gdbtk_memory_changed (struct inferior *inferior, CORE_ADDR addr,
 				  ssize_t len, const bfd_byte *data);
 static void gdbtk_context_change (int);
+static void gdbtk_inferior_exit (struct inferior *);
+static void gdbtk_free_objfile (struct objfile *);
+static void gdbtk_new_objfile (struct objfile *);
 static void gdbtk_error_begin (void);
 void report_error (void);
 static void gdbtk_annotate_signal (void);
@@ -109,6 +115,7 @@ class gdbtk_file : public ui_file
 public:
   virtual long read (char *buf, long length_buf) override;
   virtual void write (const char *buf, long length_buf) override;
+  virtual void flush () override;
 };
 
 static int gdbtk_load_hash (const char *, unsigned long);
@@ -132,6 +139,9 @@ gdbtk_add_hooks (void)
   gdb::observers::command_param_changed.attach (gdbtk_param_changed);
   gdb::observers::register_changed.attach (gdbtk_register_changed);
   gdb::observers::traceframe_changed.attach (gdbtk_trace_find);
+  gdb::observers::inferior_exit.attach (gdbtk_inferior_exit);
+  gdb::observers::free_objfile.attach (gdbtk_free_objfile);
+  gdb::observers::new_objfile.attach (gdbtk_new_objfile);
 
   /* Hooks */
   deprecated_call_command_hook = gdbtk_call_command;
@@ -200,6 +210,9 @@ gdbtk_two_elem_cmd (const char *cmd_name, const char *argv1)
   int result, flags_ptr, arg_len, cmd_len;
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  /* Keep the console output in order with whatever this shows.  */
+  gdbtk_flush_output ();
+
   arg_len = Tcl_ScanElement (argv1, &flags_ptr);
   cmd_len = strlen (cmd_name);
   command = (char *) malloc (arg_len + cmd_len + 2);
@@ -233,6 +246,7 @@ gdbtk_file::read (char *buf, long sizeof_buf)
 
   if (this == gdb_stdtargin)
     {
+      gdbtk_flush_output ();
       result = Tcl_Eval (interp->tcl, "gdbtk_console_read");
       if (result != TCL_OK)
         {
@@ -263,6 +277,134 @@ gdbtk_file::read (char *buf, long sizeof_buf)
 }
 
 
+/* Output for the console is gathered here and handed to Tcl in large
+   batches, rather than evaluating a Tcl command for every write.  A
+   batch is flushed when it reaches GDBTK_OUTPUT_BATCH_SIZE bytes or
+   GDBTK_OUTPUT_BATCH_LINES lines, when output for another stream comes
+   in, when gdb flushes the stream, when Tcl is about to run (at the
+   end of every gdbtk command, before queries...) and when idle.  */
+
+#define GDBTK_OUTPUT_BATCH_SIZE		(64 * 1024)
+#define GDBTK_OUTPUT_BATCH_LINES	1024
+
+enum gdbtk_output_stream
+  {
+    GDBTK_OUTPUT_CONSOLE,
+    GDBTK_OUTPUT_LOG,
+    GDBTK_OUTPUT_TARGET,
+    GDBTK_OUTPUT_STREAMS
+  };
+
+/* The Tcl procedures receiving each stream.  */
+static const char *const gdbtk_output_procs[GDBTK_OUTPUT_STREAMS] =
+  {
+    "gdbtk_tcl_fputs",
+    "gdbtk_tcl_fputs_log",
+    "gdbtk_tcl_fputs_target"
+  };
+
+/* Their names, as shared objects so Tcl keeps them resolved.  */
+static Tcl_Obj *gdbtk_output_cmds[GDBTK_OUTPUT_STREAMS];
+
+/* The console window tags of each stream.  */
+static const char *const gdbtk_output_tags[GDBTK_OUTPUT_STREAMS] =
+  {
+    "",
+    "log_tag",
+    "target_tag"
+  };
+
+static std::string gdbtk_output;
+static enum gdbtk_output_stream gdbtk_output_kind;
+static size_t gdbtk_output_lines = 0;
+static bool gdbtk_output_queued = false;
+
+void
+gdbtk_flush_output (void)
+{
+  Tcl_Obj *objv[2], *saved;
+  std::string text;
+  bool in_write;
+  Tcl_Interp *tcl = gdbtk_get_interp ()->tcl;
+
+  if (gdbtk_output.empty ())
+    return;
+
+  /* The Tcl code may write in turn.  */
+  text.swap (gdbtk_output);
+  gdbtk_output_lines = 0;
+
+  /* The console keeps the output even while no window shows it.  */
+  gdbtk_console_log_append (gdbtk_output_tags[gdbtk_output_kind],
+			    text.data (), text.size ());
+
+  if (gdbtk_output_cmds[gdbtk_output_kind] == NULL)
+    {
+      gdbtk_output_cmds[gdbtk_output_kind] =
+	Tcl_NewStringObj (gdbtk_output_procs[gdbtk_output_kind], -1);
+      Tcl_IncrRefCount (gdbtk_output_cmds[gdbtk_output_kind]);
+    }
+
+  objv[0] = gdbtk_output_cmds[gdbtk_output_kind];
+  objv[1] = Tcl_NewStringObj (text.data (), text.size ());
+  Tcl_IncrRefCount (objv[1]);
+
+  /* We may be called with the result of a command already in place.  */
+  saved = Tcl_GetObjResult (tcl);
+  Tcl_IncrRefCount (saved);
+
+  in_write = gdbtk_in_write;
+  gdbtk_in_write = true;
+  if (Tcl_EvalObjv (tcl, 2, objv, TCL_EVAL_GLOBAL) != TCL_OK)
+    report_error ();
+  gdbtk_in_write = in_write;
+
+  Tcl_SetObjResult (tcl, saved);
+  Tcl_DecrRefCount (saved);
+  Tcl_DecrRefCount (objv[1]);
+}
+
+static void
+gdbtk_output_idle (ClientData clientData)
+{
+  gdbtk_output_queued = false;
+  gdbtk_flush_output ();
+}
+
+/* Add LENGTH bytes of BUF to the output for stream KIND.  */
+static void
+gdbtk_buffer_output (enum gdbtk_output_stream kind, const char *buf,
+		     size_t length)
+{
+  size_t lines;
+
+  if (!gdbtk_output.empty () && kind != gdbtk_output_kind)
+    gdbtk_flush_output ();
+
+  gdbtk_output_kind = kind;
+  gdbtk_output.append (buf, length);
+  lines = std::count (buf, buf + length, '\n');
+  gdbtk_output_lines += lines;
+
+  /* While the inferior runs, the GUI may only be serviced on its own
+     input: show complete lines of the target right away.  */
+  if (gdbtk_output.size () >= GDBTK_OUTPUT_BATCH_SIZE
+      || gdbtk_output_lines >= GDBTK_OUTPUT_BATCH_LINES
+      || (running_now && lines != 0))
+    gdbtk_flush_output ();
+  else if (!gdbtk_output_queued)
+    {
+      gdbtk_output_queued = true;
+      Tcl_DoWhenIdle (gdbtk_output_idle, NULL);
+    }
+}
+
+void
+gdbtk_file::flush ()
+{
+  gdbtk_flush_output ();
+}
+
 /* This handles all the output from gdb.  All the gdb printf_xxx functions
  * eventually end up here.  The output is either passed to the result_ptr
  * where it will go to the result of some gdbtk command, or passed to the
@@ -274,6 +416,8 @@ gdbtk_file::read (char *buf, long sizeof_buf)
  * 1) result_ptr == NULL - This happens when some output comes from gdb which
  *    is not generated by a command in gdbtk-cmds, usually startup stuff.
  *    In this case we just route the data to gdbtk_tcl_fputs.
+ *    Data going to gdbtk_tcl_fputs (or to the log and target procs) is
+ *    batched, see gdbtk_buffer_output.
  * 2) The GDBTK_TO_RESULT flag is set - The result is supposed to go to Tcl.
  *    We place the data into the result_ptr, either as a string,
  *    or a list, depending whether the GDBTK_MAKES_LIST bit is set.
@@ -296,15 +440,26 @@ gdbtk_file::write (const char *buf, long length_buf)
     return;
 
   gdbtk_in_write = true;
-  tmp = std::string(buf, (size_t) length_buf);
-  ptr = (char *) tmp.data ();
 
   if (this == gdb_stdlog)
-    gdbtk_two_elem_cmd ("gdbtk_tcl_fputs_log", ptr);
+    gdbtk_buffer_output (GDBTK_OUTPUT_LOG, buf, length_buf);
   else if (this == gdb_stdtarg)
-    gdbtk_two_elem_cmd ("gdbtk_tcl_fputs_target", ptr);
-  else if (result_ptr != NULL)
+    gdbtk_buffer_output (GDBTK_OUTPUT_TARGET, buf, length_buf);
+  else if (result_ptr != NULL
+	   && !(result_ptr->flags & (GDBTK_TO_RESULT | GDBTK_ERROR_ONLY))
+	   && this != gdb_stderr)
+    {
+      gdbtk_buffer_output (GDBTK_OUTPUT_CONSOLE, buf, length_buf);
+      if (result_ptr->flags & GDBTK_MAKES_LIST)
+	gdbtk_buffer_output (GDBTK_OUTPUT_CONSOLE, " ", 1);
+    }
+  else if (result_ptr == NULL)
+    gdbtk_buffer_output (GDBTK_OUTPUT_CONSOLE, buf, length_buf);
+  else
     {
+      tmp = std::string (buf, (size_t) length_buf);
+      ptr = (char *) tmp.data ();
+
       if (result_ptr->flags & GDBTK_TO_RESULT)
 	{
 	  if (result_ptr->flags & GDBTK_MAKES_LIST)
@@ -323,16 +478,6 @@ gdbtk_file::write (const char *buf, long length_buf)
 	      result_ptr->flags |= GDBTK_ERROR_STARTED;
 	    }
 	}
-      else
-	{
-	  gdbtk_two_elem_cmd ("gdbtk_tcl_fputs", ptr);
-	  if (result_ptr->flags & GDBTK_MAKES_LIST)
-	    gdbtk_two_elem_cmd ("gdbtk_tcl_fputs", " ");
-	}
-    }
-  else
-    {
-      gdbtk_two_elem_cmd ("gdbtk_tcl_fputs", ptr);
     }
 
   gdbtk_in_write = false;
@@ -430,28 +575,139 @@ gdbtk_ignorable_warning (const char *warnclass, const char *warning)
 
   buf = xstrprintf ("gdbtk_tcl_ignorable_warning {%s} {%s}",
 		    warnclass, warning);
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, buf) != TCL_OK)
     report_error ();
   free(buf);
 }
 
+/* The categories of target state changed since the windows were
+   last updated (GDBTK_UPDATE_* flags), and whether an update is
+   already queued.  A script writing many registers or memory
+   locations thus causes a single update.  */
+static int gdbtk_dirty = 0;
+static bool gdbtk_update_queued = false;
+
+/* The memory written since the windows were last updated, as
+   disjoint [start, end) ranges indexed by their start.  Past
+   GDBTK_MAX_DIRTY_RANGES ranges, they are dropped and all the memory
+   is considered changed.  */
+#define GDBTK_MAX_DIRTY_RANGES 64
+static std::map<CORE_ADDR, CORE_ADDR> gdbtk_dirty_ranges;
+static bool gdbtk_dirty_ranges_overflow = false;
+
+/* Add [START, END) to the dirty memory ranges, merging it with the
+   ranges it overlaps or touches.  */
 static void
-gdbtk_register_changed (struct frame_info *frame, int regno)
+gdbtk_add_dirty_range (CORE_ADDR start, CORE_ADDR end)
 {
-  gdbtk_interp *interp = gdbtk_get_interp ();
+  if (gdbtk_dirty_ranges_overflow)
+    return;
+
+  /* A write up to the end of the address space.  */
+  if (end < start)
+    end = (CORE_ADDR) -1;
+
+  auto it = gdbtk_dirty_ranges.upper_bound (start);
+  if (it != gdbtk_dirty_ranges.begin ()
+      && std::prev (it)->second >= start)
+    --it;
+
+  while (it != gdbtk_dirty_ranges.end () && it->first <= end)
+    {
+      start = std::min (start, it->first);
+      end = std::max (end, it->second);
+      it = gdbtk_dirty_ranges.erase (it);
+    }
+
+  if (gdbtk_dirty_ranges.size () >= GDBTK_MAX_DIRTY_RANGES)
+    {
+      gdbtk_dirty_ranges.clear ();
+      gdbtk_dirty_ranges_overflow = true;
+      return;
+    }
+
+  gdbtk_dirty_ranges.emplace (start, end);
+}
+
+static void
+gdbtk_dispatch_update (ClientData clientData)
+{
+  gdbtk_update_queued = false;
+
+  /* A full update may have been run in the meantime.  */
+  if (gdbtk_dirty == 0)
+    return;
 
-  if (Tcl_Eval (interp->tcl, "gdbtk_register_changed") != TCL_OK)
+  gdbtk_flush_output ();
+  if (Tcl_GlobalEval (gdbtk_get_interp ()->tcl, "gdbtk_update_safe")
+      != TCL_OK)
     report_error ();
 }
 
+void
+gdbtk_schedule_update (int what)
+{
+  gdbtk_dirty |= what;
+  if (!gdbtk_update_queued)
+    {
+      gdbtk_update_queued = true;
+      Tcl_DoWhenIdle (gdbtk_dispatch_update, NULL);
+    }
+}
+
+int
+gdbtk_take_dirty (std::vector<std::pair<CORE_ADDR, CORE_ADDR>> *ranges)
+{
+  int dirty = gdbtk_dirty;
+
+  if (ranges != NULL)
+    {
+      ranges->clear ();
+      if (!gdbtk_dirty_ranges_overflow)
+	ranges->assign (gdbtk_dirty_ranges.begin (),
+			gdbtk_dirty_ranges.end ());
+    }
+
+  gdbtk_dirty = 0;
+  gdbtk_dirty_ranges.clear ();
+  gdbtk_dirty_ranges_overflow = false;
+  return dirty;
+}
+
+static void
+gdbtk_register_changed (struct frame_info *frame, int regno)
+{
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_schedule_update (GDBTK_UPDATE_REGISTERS);
+}
+
 static void
 gdbtk_memory_changed (struct inferior *inferior, CORE_ADDR addr,
 		      ssize_t len, const bfd_byte *data)
 {
-  gdbtk_interp *interp = gdbtk_get_interp ();
+  gdbtk_memory_cache_invalidate (addr, len);
+  gdbtk_disassembly_cache_invalidate (addr, len);
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  if (len > 0)
+    gdbtk_add_dirty_range (addr, addr + len);
+  gdbtk_schedule_update (GDBTK_UPDATE_MEMORY);
+}
 
-  if (Tcl_Eval (interp->tcl, "gdbtk_memory_changed") != TCL_OK)
-    report_error ();
+/* Called after commands which write the target memory without a
+   memory_changed notification ("load", "restore"), and may set the
+   registers too: forget all that was read from the target.  */
+
+static void
+gdbtk_memory_rewritten (void)
+{
+  gdbtk_memory_cache_flush ();
+  gdbtk_disassembly_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_schedule_update (GDBTK_UPDATE_MEMORY | GDBTK_UPDATE_REGISTERS);
 }
 
 
@@ -505,8 +761,7 @@ x_event (int signo)
   gdbtk_force_detach = 0;
 
   /* Process pending events */
-  while (Tcl_DoOneEvent (TCL_DONT_WAIT | TCL_ALL_EVENTS) != 0)
-    ;
+  gdbtk_process_events ();
 
   if (load_in_progress)
     {
@@ -579,6 +834,7 @@ gdbtk_readline_end (void)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, "gdbtk_tcl_readline_end") != TCL_OK)
     report_error ();
 }
@@ -595,6 +851,7 @@ gdbtk_call_command (struct cmd_list_element *cmdblk,
       int tracerunning = current_trace_status ()->running;
 
       running_now = 1;
+      gdbtk_flush_output ();
       if (!No_Update)
 	Tcl_Eval (interp->tcl, "gdbtk_tcl_busy");
       cmd_func (cmdblk, arg, from_tty);
@@ -611,9 +868,25 @@ gdbtk_call_command (struct cmd_list_element *cmdblk,
         gdbtk_trace_start_stop (current_trace_status ()->running, from_tty);
 
       running_now = 0;
+      gdbtk_flush_output ();
       if (!No_Update)
 	Tcl_Eval (interp->tcl, "gdbtk_tcl_idle");
     }
+  else if (strcmp (cmdblk->name, "load") == 0
+	   || strcmp (cmdblk->name, "restore") == 0)
+    {
+      /* Even a failed download may have written some memory.  */
+      try
+	{
+	  cmd_func (cmdblk, arg, from_tty);
+	}
+      catch (const gdb_exception &)
+	{
+	  gdbtk_memory_rewritten ();
+	  throw;
+	}
+      gdbtk_memory_rewritten ();
+    }
   else
     cmd_func (cmdblk, arg, from_tty);
 }
@@ -625,9 +898,20 @@ gdbtk_call_command (struct cmd_list_element *cmdblk,
 static void
 gdbtk_param_changed (const char *param, const char *value)
 {
+  static const char *const disassembly_params[] =
+    {
+      "disassembly-flavor", "disassembler-options", "print asm-demangle",
+      "print max-symbolic-offset", NULL
+    };
   Tcl_DString cmd;
   char *buffer = NULL;
   gdbtk_interp *interp = gdbtk_get_interp ();
+  int i;
+
+  /* The cached disassembly was printed with the old setting.  */
+  for (i = 0; disassembly_params[i] != NULL; i++)
+    if (strcmp (param, disassembly_params[i]) == 0)
+      gdbtk_disassembly_cache_flush ();
 
   Tcl_DStringInit (&cmd);
   Tcl_DStringAppendElement (&cmd, "gdbtk_tcl_set_variable");
@@ -635,6 +919,7 @@ gdbtk_param_changed (const char *param, const char *value)
   Tcl_DStringAppendElement (&cmd, param);
   Tcl_DStringAppendElement (&cmd, value);
 
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, Tcl_DStringValue (&cmd)) != TCL_OK)
     report_error ();
 
@@ -653,6 +938,7 @@ gdbtk_load_hash (const char *section, unsigned long num)
   gdbtk_interp *interp = gdbtk_get_interp ();
 
   buf = xstrprintf ("Download::download_hash %s %ld", section, num);
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, buf) != TCL_OK)
     report_error ();
   free(buf);
@@ -675,6 +961,13 @@ gdbtk_post_add_symbol (void)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_disassembly_cache_flush ();
+  gdbtk_executable_lines_flush ();
+  gdbtk_function_index_flush ();
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, "gdbtk_tcl_post_add_symbol") != TCL_OK)
     report_error ();
 }
@@ -690,6 +983,9 @@ gdbtk_wait (ptid_t ptid, struct target_waitstatus *ourstatus, int options)
   ptid = target_wait (ptid, ourstatus, options);
   gdbtk_stop_timer ();
   gdbtk_ptid = ptid;
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
 
   return ptid;
 }
@@ -742,11 +1038,17 @@ gdbtk_trace_find (int tfnum, int tpnum)
   gdbtk_interp *interp = gdbtk_get_interp ();
   Tcl_Obj *cmdObj;
 
+  /* Memory now comes from the selected trace frame.  */
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+
   cmdObj = Tcl_NewListObj (0, NULL);
   Tcl_ListObjAppendElement (interp->tcl, cmdObj,
 			    Tcl_NewStringObj ("gdbtk_tcl_trace_find_hook", -1));
   Tcl_ListObjAppendElement (interp->tcl, cmdObj, Tcl_NewIntObj (tfnum));
   Tcl_ListObjAppendElement (interp->tcl, cmdObj, Tcl_NewIntObj (tpnum));
+  gdbtk_flush_output ();
 #if TCL_MAJOR_VERSION == 8 && (TCL_MINOR_VERSION < 1 || TCL_MINOR_VERSION > 2)
   if (Tcl_GlobalEvalObj (interp->tcl, cmdObj) != TCL_OK)
     report_error ();
@@ -770,6 +1072,7 @@ gdbtk_trace_start_stop (int start, int from_tty)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_flush_output ();
   if (start)
     Tcl_GlobalEval (interp->tcl, "gdbtk_tcl_tstart");
   else
@@ -783,12 +1086,47 @@ static void
 gdbtk_context_change (int num)
 {
   gdb_context = num;
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_schedule_update (GDBTK_UPDATE_CONTEXT);
+}
+
+/* Called when an inferior exits or is killed. */
+static void
+gdbtk_inferior_exit (struct inferior *inf)
+{
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+}
+
+/* Called before an objfile, and so its symtabs, is freed. */
+static void
+gdbtk_free_objfile (struct objfile *objfile)
+{
+  gdbtk_executable_lines_flush ();
+  gdbtk_function_index_flush ();
+}
+
+/* Called when symbols are added, shared libraries' among others, or
+   all discarded (OBJFILE is NULL then).  */
+static void
+gdbtk_new_objfile (struct objfile *objfile)
+{
+  gdbtk_function_index_flush ();
 }
 
 /* Called from file_command */
 static void
 gdbtk_file_changed (const char *filename)
 {
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_disassembly_cache_flush ();
+  gdbtk_executable_lines_flush ();
+  gdbtk_function_index_flush ();
   gdbtk_two_elem_cmd ("gdbtk_tcl_file_changed", filename);
 }
 
@@ -820,6 +1158,7 @@ gdbtk_annotate_signal (void)
      a necessary stop button evil. We don't want signal notification
      to interfere with the elaborate and painful stop button detach
      timeout. */
+  gdbtk_flush_output ();
   Tcl_Eval (interp->tcl, "gdbtk_stop_idle_callback");
 
   if (inferior_ptid == null_ptid)
@@ -840,6 +1179,10 @@ gdbtk_attach (void)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl,
                 "after idle \"update idletasks;gdbtk_attached\"") != TCL_OK)
     {
@@ -852,6 +1195,10 @@ gdbtk_detach (void)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_flush_output ();
   if (Tcl_Eval (interp->tcl, "gdbtk_detached") != TCL_OK)
     {
       report_error ();
@@ -864,6 +1211,11 @@ gdbtk_architecture_changed (struct gdbarch *ignore)
 {
   gdbtk_interp *interp = gdbtk_get_interp ();
 
+  gdbtk_memory_cache_flush ();
+  gdbtk_stack_cache_flush ();
+  gdbtk_register_cache_flush ();
+  gdbtk_disassembly_cache_flush ();
+  gdbtk_flush_output ();
   Tcl_Eval (interp->tcl, "gdbtk_tcl_architecture_changed");
 }
 
@@ -28,6 +28,8 @@
 #include "language.h"
 #include "valprint.h"
 #include "arch-utils.h"
+#include <map>
+#include <tuple>
 
 #include <tcl.h>
 #include "gdbtk.h"
@@ -35,7 +37,11 @@
 #include "gdbtk-interp.h"
 
 
-/* Extended reg_buffer class to handle register comparison, types & formats. */
+/* Extended reg_buffer class to handle register comparison, types & formats.
+   The reg_buffer holds the register contents last reported as changed.
+   The registers of the selected frame are read once in a snapshot,
+   and their formatted values are memoized, until the snapshot is
+   flushed or another frame is selected.  */
 
 class gdbtk_reg_buffer : public reg_buffer
 {
@@ -47,7 +53,15 @@ public:
     return gdbarch_num_regs (arch ()) + gdbarch_num_pseudo_regs (arch ());
   }
 
-  bool changed_p (int regnum);
+  struct value *get_value (struct frame_info *frame, int regnum);
+  bool changed_p (struct frame_info *frame, int regnum);
+  bool error_changed_p (int regnum, const char *message);
+  const std::string &formatted (struct frame_info *frame, int regnum);
+  void flush ()
+  {
+    m_snapshot_valid = false;
+  }
+
   int get_format (int regnum) const
   {
     return m_format[regnum];
@@ -68,6 +82,26 @@ public:
 protected:
   std::vector<int> m_format;
   std::vector<struct type *> m_type;
+
+private:
+  void snapshot (struct frame_info *frame);
+
+  /* The snapshot of the registers of frame M_SNAPSHOT_FRAME: their
+     raw contents, in a single buffer, their status (REG_UNKNOWN until
+     read) and their values.  */
+  bool m_snapshot_valid = false;
+  struct frame_id m_snapshot_frame;
+  std::vector<gdb_byte> m_raw;
+  std::vector<size_t> m_raw_offset;
+  std::vector<register_status> m_raw_status;
+  std::vector<value_ref_ptr> m_values;
+
+  /* The error last reported as the value of each register, empty if
+     its value was reported.  */
+  std::vector<std::string> m_error;
+
+  /* Formatted values, by register number, format and type.  */
+  std::map<std::tuple<int, int, struct type *>, std::string> m_formatted;
 };
 
 /* Argument passed to our register-mapping functions */
@@ -82,6 +116,8 @@ typedef void (*map_func)(int, map_arg);
 
 static int gdb_register_info (ClientData, Tcl_Interp *, int, Tcl_Obj **);
 static void get_register (int, map_arg);
+static void format_register (int, struct value *, struct ui_file *);
+static void get_register_snapshot (int, map_arg);
 static void get_register_name (int, map_arg);
 static void get_register_size (int, map_arg);
 static void get_register_types (int regnum, map_arg);
@@ -102,40 +138,142 @@ static gdbtk_reg_buffer *registers = NULL;
 gdbtk_reg_buffer::gdbtk_reg_buffer (gdbarch *gdbarch)
     : reg_buffer (gdbarch, true)
 {
+  size_t size = 0;
+  int regnum;
+
   m_format.resize (num_registers (), 0);
   m_type.resize (num_registers (), NULL);
+
+  for (regnum = 0; regnum < num_registers (); regnum++)
+    {
+      m_raw_offset.push_back (size);
+      size += register_size (gdbarch, regnum);
+    }
+  m_raw.resize (size);
+  m_raw_status.resize (num_registers (), REG_UNKNOWN);
+  m_values.resize (num_registers ());
+  m_error.resize (num_registers ());
 }
 
-bool gdbtk_reg_buffer::changed_p (int regnum)
+/* Start a new snapshot of the registers of FRAME, unless the current
+   snapshot is of FRAME.  */
+
+void gdbtk_reg_buffer::snapshot (struct frame_info *frame)
 {
-  bool changed = false;
+  struct frame_id id = get_frame_id (frame);
+
+  if (m_snapshot_valid && frame_id_eq (id, m_snapshot_frame))
+    return;
+
+  std::fill (m_raw_status.begin (), m_raw_status.end (), REG_UNKNOWN);
+  for (value_ref_ptr &val : m_values)
+    val.reset ();
+  m_formatted.clear ();
+  m_snapshot_frame = id;
+  m_snapshot_valid = true;
+}
+
+/* Return the value of register REGNUM in FRAME, reading it in the
+   snapshot if needed.  */
 
-  if (target_has_registers)
+struct value *gdbtk_reg_buffer::get_value (struct frame_info *frame,
+                                          int regnum)
+{
+  snapshot (frame);
+  if (m_raw_status[regnum] == REG_UNKNOWN)
     {
-      register_status regstatus = REG_VALID;
-      gdb_byte *regbuf = register_buffer (regnum);
+      struct value *val = get_frame_register_value (frame, regnum);
+      gdb_byte *raw = &m_raw[m_raw_offset[regnum]];
       int regsize = register_size (arch (), regnum);
-      struct value *val = get_frame_register_value (get_selected_frame (NULL),
-                                                    regnum);
 
       if (!val || value_optimized_out (val) || !value_entirely_available (val))
-        regstatus = REG_UNAVAILABLE;
-      changed = regstatus != m_register_status[regnum];
-      if (!changed && regstatus == REG_VALID)
-        changed = memcmp (regbuf, value_contents_all (val), regsize) != 0;
-      if (changed)
         {
-          m_register_status[regnum] = regstatus;
-          if (regstatus == REG_VALID)
-            memcpy (regbuf, value_contents_all (val), regsize);
-          else
-            memset (regbuf, 0, regsize);
+          m_raw_status[regnum] = REG_UNAVAILABLE;
+          memset (raw, 0, regsize);
+        }
+      else
+        {
+          m_raw_status[regnum] = REG_VALID;
+          memcpy (raw, value_contents_all (val), regsize);
         }
+      m_values[regnum] = value_ref_ptr::new_reference (val);
     }
+  return m_values[regnum].get ();
+}
+
+/* Record the value of register REGNUM in FRAME as reported, and return
+   true if it changed since it was last reported.  */
+
+bool gdbtk_reg_buffer::changed_p (struct frame_info *frame, int regnum)
+{
+  bool changed = false;
+  gdb_byte *regbuf = register_buffer (regnum);
+  int regsize = register_size (arch (), regnum);
+  register_status regstatus;
+  const gdb_byte *raw;
+
+  get_value (frame, regnum);
+  regstatus = m_raw_status[regnum];
+  raw = &m_raw[m_raw_offset[regnum]];
+
+  changed = regstatus != m_register_status[regnum];
+  if (!changed && regstatus == REG_VALID)
+    changed = memcmp (regbuf, raw, regsize) != 0;
+  if (changed)
+    {
+      m_register_status[regnum] = regstatus;
+      memcpy (regbuf, raw, regsize);
+      m_error[regnum].clear ();
+    }
+
+  return changed;
+}
+
+/* Record the error MESSAGE as reported for register REGNUM, and return
+   true if it differs from what was last reported.  */
+
+bool gdbtk_reg_buffer::error_changed_p (int regnum, const char *message)
+{
+  bool changed = m_error[regnum] != message;
+
+  /* Whatever the register next reads as is a change.  */
+  m_register_status[regnum] = REG_UNKNOWN;
+  if (changed)
+    m_error[regnum] = message;
 
   return changed;
 }
 
+/* Return the value of register REGNUM in FRAME, formatted in the type
+   and format set by "gdb_reginfo format".  */
+
+const std::string &gdbtk_reg_buffer::formatted (struct frame_info *frame,
+                                                int regnum)
+{
+  struct value *val = get_value (frame, regnum);
+  auto key = std::make_tuple (regnum, m_format[regnum], m_type[regnum]);
+  auto it = m_formatted.find (key);
+
+  if (it == m_formatted.end ())
+    {
+      string_file stb;
+
+      format_register (regnum, val, &stb);
+      it = m_formatted.emplace (key, std::move (stb.string ())).first;
+    }
+  return it->second;
+}
+
+/* Discard the register snapshot.  This is called whenever the target
+   may have changed.  */
+
+void
+gdbtk_register_cache_flush (void)
+{
+  if (registers != NULL)
+    registers->flush ();
+}
+
 
 int
 Gdbtk_Register_Init (Tcl_Interp *interp)
@@ -234,6 +372,13 @@ Gdbtk_Register_Init (Tcl_Interp *interp)
  *    Returns a list of special register numbers.
  *
  *    usage: gdb_reginfo special [sp | pc | ps] ...
+ *
+ * snapshot
+ *    Returns, in a single flat list, the number, name, value and changed
+ *    flag of each register, as "name", "value" and "changed" would.
+ *    The selected frame is looked up once for all the registers.
+ *
+ *    usage: gdb_reginfo snapshot [regnum0, ..., regnumN]
  */
 static int
 gdb_register_info (ClientData clientData, Tcl_Interp *interp, int objc,
@@ -244,15 +389,16 @@ gdb_register_info (ClientData clientData, Tcl_Interp *interp, int objc,
   map_func func;
   static const char *commands[] = {"changed", "name", "size", "value", "type",
                                    "format", "group", "grouplist",
-                                   "collectable", "special", NULL};
+                                   "collectable", "special", "snapshot",
+                                   NULL};
   enum commands_enum { REGINFO_CHANGED, REGINFO_NAME, REGINFO_SIZE,
                        REGINFO_VALUE, REGINFO_TYPE, REGINFO_FORMAT,
                        REGINFO_GROUP, REGINFO_GROUPLIST, REGINFO_COLLECTABLE,
-                       REGINFO_SPECIAL };
+                       REGINFO_SPECIAL, REGINFO_SNAPSHOT };
 
   if (objc < 2)
     {
-      Tcl_WrongNumArgs (interp, 1, objv, "changed|name|size|value|type|format|group|grouplist|collectable|special [regnum1 ... regnumN]");
+      Tcl_WrongNumArgs (interp, 1, objv, "changed|name|size|value|type|format|group|grouplist|collectable|special|snapshot [regnum1 ... regnumN]");
       return TCL_ERROR;
     }
 
@@ -319,6 +465,12 @@ gdb_register_info (ClientData clientData, Tcl_Interp *interp, int objc,
     case REGINFO_SPECIAL:
       return gdb_regspecial (clientData, interp, objc, objv);
 
+    case REGINFO_SNAPSHOT:
+      if (target_has_registers)
+	arg.ptr = get_selected_frame (NULL);
+      func = get_register_snapshot;
+      break;
+
     default:
       return TCL_ERROR;
     }
@@ -401,15 +553,15 @@ get_register_types (int regnum, map_arg arg)
 }
 
 
+/* Print the value VAL of register REGNUM to STB, in the type and
+   format set by "gdb_reginfo format".  */
+
 static void
-get_register (int regnum, map_arg arg)
+format_register (int regnum, struct value *val, struct ui_file *stb)
 {
   struct type *reg_vtype;
   int format;
-  string_file stb;
-  struct gdbarch *gdbarch;
-  struct value *val;
-  struct frame_info *frame;
+  struct gdbarch *gdbarch = get_value_arch (val);
 
   format = registers->get_format (regnum);
   if (format == 0)
@@ -419,23 +571,9 @@ get_register (int regnum, map_arg arg)
   if (reg_vtype == NULL)
     reg_vtype = register_type (get_current_arch (), regnum);
 
-  if (!target_has_registers)
-    {
-      if (result_ptr->flags & GDBTK_MAKES_LIST)
-	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, Tcl_NewStringObj ("", -1));
-      else
-	Tcl_SetStringObj (result_ptr->obj_ptr, "", -1);
-      return;
-    }
-
-  frame = get_selected_frame (NULL);
-  gdbarch = get_frame_arch (frame);
-  val = get_frame_register_value (frame, regnum);
-
   if (value_optimized_out (val))
     {
-      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
-				Tcl_NewStringObj ("Optimized out", -1));
+      fputs_unfiltered ("Optimized out", stb);
       return;
     }
 
@@ -455,7 +593,7 @@ get_register (int regnum, map_arg arg)
 	  sprintf (ptr, "%02x", (unsigned char) valaddr[idx]);
 	  ptr += 2;
 	}
-      fputs_unfiltered (buf, &stb);
+      fputs_unfiltered (buf, stb);
     }
   else
     {
@@ -466,13 +604,68 @@ get_register (int regnum, map_arg arg)
       opts.prettyformat = Val_prettyformat_default;
       val_print (reg_vtype,
 		 value_embedded_offset (val), 0,
-		 &stb, 0, val, &opts, current_language);
+		 stb, 0, val, &opts, current_language);
+    }
+}
+
+static void
+get_register (int regnum, map_arg arg)
+{
+  string_file stb;
+
+  if (!target_has_registers)
+    {
+      if (result_ptr->flags & GDBTK_MAKES_LIST)
+	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, Tcl_NewStringObj ("", -1));
+      else
+	Tcl_SetStringObj (result_ptr->obj_ptr, "", -1);
+      return;
     }
 
+  const std::string &value
+    = registers->formatted (get_selected_frame (NULL), regnum);
+
   if (result_ptr->flags & GDBTK_MAKES_LIST)
-    Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, Tcl_NewStringObj (stb.data (), -1));
+    Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+			      Tcl_NewStringObj (value.c_str (), value.size ()));
   else
-    Tcl_SetStringObj (result_ptr->obj_ptr, stb.data (), -1);
+    Tcl_SetStringObj (result_ptr->obj_ptr, value.c_str (), value.size ());
+}
+
+/* Append the number, name, value and changed flag of register REGNUM
+   of frame ARG.ptr (NULL if there are no registers) to the result.  */
+
+static void
+get_register_snapshot (int regnum, map_arg arg)
+{
+  struct frame_info *frame = (struct frame_info *) arg.ptr;
+  Tcl_Obj *elts[4];
+  bool changed = false;
+
+  elts[2] = Tcl_NewObj ();
+  if (frame != NULL)
+    {
+      /* A register which cannot be read or formatted shows the error
+	 as its value, rather than failing the whole snapshot.  */
+      try
+	{
+	  const std::string &value = registers->formatted (frame, regnum);
+
+	  changed = registers->changed_p (frame, regnum);
+	  Tcl_SetStringObj (elts[2], value.c_str (), value.size ());
+	}
+      catch (const gdb_exception &ex)
+	{
+	  changed = registers->error_changed_p (regnum, ex.what ());
+	  Tcl_SetStringObj (elts[2], ex.what (), -1);
+	}
+    }
+
+  elts[0] = Tcl_NewIntObj (regnum);
+  elts[1] = Tcl_NewStringObj (gdbarch_register_name (get_current_arch (),
+						     regnum), -1);
+  elts[3] = Tcl_NewBooleanObj (changed);
+  Tcl_ListObjReplace (NULL, result_ptr->obj_ptr, INT_MAX, 0, 4, elts);
 }
 
 static void
@@ -562,7 +755,8 @@ register_changed_p (int regnum, map_arg arg)
 {
   gdb_assert (regnum < registers->num_registers ());
 
-  if (registers->changed_p (regnum))
+  if (target_has_registers
+      && registers->changed_p (get_selected_frame (NULL), regnum))
     Tcl_ListObjAppendElement (NULL,
                               result_ptr->obj_ptr, Tcl_NewIntObj (regnum));
 }
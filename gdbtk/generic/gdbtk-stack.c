@@ -59,6 +59,20 @@ static int gdb_selected_frame_level (ClientData clientData,
 static int gdb_stack (ClientData, Tcl_Interp *, int, Tcl_Obj * CONST[]);
 static void get_frame_name (Tcl_Interp *interp, Tcl_Obj *list,
 			    struct frame_info *fi);
+static int stack_cache_fill (Tcl_Interp *interp, int count);
+
+/* The names of the stack frames, from the innermost one, as returned
+   by gdb_stack.  FRAMES is filled as deeper frames are requested, and
+   is COMPLETE when it reaches the outermost frame.  The cache is
+   flushed whenever the target may have changed, or when the innermost
+   frame is no longer TOP_ID.  */
+
+static struct
+{
+  Tcl_Obj *frames;
+  bool complete;
+  struct frame_id top_id;
+} stack_cache;
 
 int
 Gdbtk_Stack_Init (Tcl_Interp *interp)
@@ -464,24 +478,107 @@ gdb_selected_frame_level (ClientData clientData, Tcl_Interp *interp,
   return TCL_OK;
 }
 
+/* Discard the cached stack frame names.  */
+
+void
+gdbtk_stack_cache_flush (void)
+{
+  if (stack_cache.frames != NULL)
+    {
+      Tcl_DecrRefCount (stack_cache.frames);
+      stack_cache.frames = NULL;
+    }
+  stack_cache.complete = false;
+}
+
+/* Make sure the names of the COUNT innermost frames, or of all of them
+   if COUNT is negative, are cached.  The frames are unwound from the
+   innermost one, up to the last frame needed.  */
+
+static int
+stack_cache_fill (Tcl_Interp *interp, int count)
+{
+  struct frame_info *fi;
+  int cached, level;
+
+  if (GDB_get_current_frame (&fi) != GDB_OK)
+    return TCL_ERROR;
+
+  /* Commands like "return" change the stack without resuming.  */
+  if (stack_cache.frames != NULL
+      && !frame_id_eq (get_frame_id (fi), stack_cache.top_id))
+    gdbtk_stack_cache_flush ();
+
+  if (stack_cache.frames == NULL)
+    {
+      stack_cache.frames = Tcl_NewListObj (0, NULL);
+      Tcl_IncrRefCount (stack_cache.frames);
+      stack_cache.top_id = get_frame_id (fi);
+    }
+
+  Tcl_ListObjLength (NULL, stack_cache.frames, &cached);
+  if (stack_cache.complete || (count >= 0 && cached >= count))
+    return TCL_OK;
+
+  /* Skip the frames already described.  GDB caches the frames, so
+     this is cheap compared to their symbolization.  */
+  for (level = 0; fi != NULL && level < cached; level++)
+    if (GDB_get_prev_frame (fi, &fi) != GDB_OK)
+      fi = NULL;
+
+  for (; fi != NULL && (count < 0 || level < count); level++)
+    {
+      get_frame_name (interp, stack_cache.frames, fi);
+      if (GDB_get_prev_frame (fi, &fi) != GDB_OK)
+	fi = NULL;
+    }
+
+  if (fi == NULL)
+    {
+      if (level < cached)
+	Tcl_ListObjReplace (NULL, stack_cache.frames, level, cached - level,
+			    0, NULL);
+      stack_cache.complete = true;
+    }
+  return TCL_OK;
+}
+
 /* This implements the tcl command gdb_stack.
  * It builds up a list of stack frames.
  *
  * Tcl Arguments:
- *    start  - starting stack frame
+ *    start  - starting stack frame, from the outermost one
  *    count - number of frames to inspect
+ *  or:
+ *    -level level - starting stack frame level, from the innermost one
+ *    count - number of frames to inspect, going outwards
  * Tcl Result:
- *    A list of function names
+ *    A list of function names, from the outermost frame.
+ *    With -level, a list of the function names, from the innermost
+ *    frame, and of a boolean telling whether there are more frames.
+ *
+ * Only the frames up to the last requested one are unwound, and the
+ * function names are cached until the target changes.
  */
 static int
 gdb_stack (ClientData clientData, Tcl_Interp *interp,
 	   int objc, Tcl_Obj *CONST objv[])
 {
-  int start, count;
+  int start, count, cached, i;
+  int by_level = 0;
+  Tcl_Obj **frames;
+
+  if (objc == 4
+      && strcmp (Tcl_GetStringFromObj (objv[1], NULL), "-level") == 0)
+    {
+      by_level = 1;
+      objc--;
+      objv++;
+    }
 
   if (objc < 3)
     {
-      Tcl_WrongNumArgs (interp, 1, objv, "start count");
+      Tcl_WrongNumArgs (interp, 1, objv, "?-level? start count");
       return TCL_ERROR;
     }
 
@@ -496,47 +593,47 @@ gdb_stack (ClientData clientData, Tcl_Interp *interp,
       return TCL_ERROR;
     }
 
-  if (target_has_stack)
+  result_ptr->obj_ptr = Tcl_NewListObj (0, NULL);
+  if (!target_has_stack)
+    {
+      if (by_level)
+	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				  Tcl_NewBooleanObj (0));
+      return TCL_OK;
+    }
+
+  if (by_level)
+    {
+      Tcl_Obj *list = Tcl_NewListObj (0, NULL);
+
+      /* Describe one more frame, to know whether there are more.  */
+      if (start < 0)
+	start = 0;
+      if (stack_cache_fill (interp, count < 0 || count > INT_MAX - start - 1
+				    ? -1 : start + count + 1) != TCL_OK)
+	{
+	  Tcl_DecrRefCount (list);
+	  return TCL_ERROR;
+	}
+
+      Tcl_ListObjGetElements (NULL, stack_cache.frames, &cached, &frames);
+      for (i = start; i < cached && (count < 0 || i - start < count); i++)
+	Tcl_ListObjAppendElement (NULL, list, frames[i]);
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, list);
+      Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr,
+				Tcl_NewBooleanObj (i < cached));
+    }
+  else
     {
-      gdb_result r;
-      struct frame_info *top;
-      struct frame_info *fi;
-
-      /* Find the outermost frame */
-      r  = GDB_get_current_frame (&fi);
-      if (r != GDB_OK)
-        return TCL_ERROR;
-
-      while (fi != NULL)
-        {
-          top = fi;
-          r = GDB_get_prev_frame (fi, &fi);
-          if (r != GDB_OK)
-            fi = NULL;
-        }
-
-      result_ptr->obj_ptr = Tcl_NewListObj (0, NULL);
-
-      /* top now points to the top (outermost frame) of the
-         stack, so point it to the requested start */
-      start = -start;
-      r = GDB_find_relative_frame (top, &start, &top);
-      if (r != GDB_OK)
-        return TCL_OK;
-
-      /* If start != 0, then we have asked to start outputting
-         frames beyond the innermost stack frame */
-      if (start == 0)
-        {
-          fi = top;
-          while (fi && count--)
-            {
-              get_frame_name (interp, result_ptr->obj_ptr, fi);
-              r = GDB_get_next_frame (fi, &fi);
-              if (r != GDB_OK)
-                break;
-            }
-        }
+      /* Counting from the outermost frame needs the whole stack.  */
+      if (stack_cache_fill (interp, -1) != TCL_OK)
+	return TCL_ERROR;
+
+      Tcl_ListObjGetElements (NULL, stack_cache.frames, &cached, &frames);
+      if (start < 0)
+	start = cached;
+      for (i = cached - 1 - start; i >= 0 && count--; i--)
+	Tcl_ListObjAppendElement (NULL, result_ptr->obj_ptr, frames[i]);
     }
 
   return TCL_OK;
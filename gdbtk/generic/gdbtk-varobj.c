@@ -56,7 +56,10 @@ static int variable_create (Tcl_Interp *, int, Tcl_Obj * CONST[]);
 
 static void variable_delete (Tcl_Interp *, struct varobj *, int);
 
-static Tcl_Obj *variable_children (Tcl_Interp *, struct varobj *);
+static Tcl_Obj *variable_children (Tcl_Interp *, struct varobj *,
+				   int, int);
+
+static void variable_release (Tcl_Interp *, struct varobj *, int, int);
 
 static int variable_format (Tcl_Interp *, int, Tcl_Obj * CONST[],
 			    struct varobj *);
@@ -70,10 +73,18 @@ static int variable_value (Tcl_Interp *, int, Tcl_Obj * CONST[],
 static int variable_print (Tcl_Interp *, int, Tcl_Obj * CONST[],
 			   struct varobj *);
 
-static Tcl_Obj *variable_update (Tcl_Interp * interp, struct varobj **var);
+static Tcl_Obj *variable_update (Tcl_Interp * interp, struct varobj **var,
+				 int records_p);
 
 /* Helper functions for the above subcommands. */
 
+static int variable_print_value (struct varobj *, std::string &);
+
+static int variable_range (Tcl_Interp *, int, Tcl_Obj * CONST[],
+			   int *, int *);
+
+static void variable_address (Tcl_Interp *, struct varobj *);
+
 static void install_variable (Tcl_Interp *, const char *);
 
 static void uninstall_variable (Tcl_Interp *, const char *);
@@ -161,9 +172,15 @@ gdb_variable_command (ClientData clientData, Tcl_Interp *interp,
 
    Currently the following commands are implemented:
    - delete        delete this object and its children
-   - update        update the variable and its children (root vars only)
+   - update        update the variable and its children (root vars only);
+                   with -records, describe each change instead of just
+                   naming the changed objects
    - numChildren   how many children does this object have
-   - children      create the children and return a list of their objects
+   - children      create the children and return a list of their objects;
+                   given OFFSET and COUNT, only those in that range
+   - release       delete the children outside of OFFSET and COUNT (or
+                   all the children)
+   - address       the {start end} memory range of the value, if any
    - name          print out the name of this variable
    - format        query/set the display format of this variable
    - type          get the type of this variable
@@ -186,7 +203,9 @@ variable_obj_command (ClientData clientData, Tcl_Interp *interp,
       VARIABLE_PRINT,
       VARIABLE_NAME,
       VARIABLE_EDITABLE,
-      VARIABLE_UPDATE
+      VARIABLE_UPDATE,
+      VARIABLE_RELEASE,
+      VARIABLE_ADDRESS
     };
   static const char *commands[] =
     {
@@ -200,11 +219,14 @@ variable_obj_command (ClientData clientData, Tcl_Interp *interp,
       "name",
       "editable",
       "update",
+      "release",
+      "address",
       NULL
     };
   struct varobj *var;
   char *varobj_name;
   int index, result;
+  int from, to;
 
   /* Get the current handle for this variable token (name). */
   varobj_name = Tcl_GetStringFromObj (objv[0], NULL);
@@ -245,8 +267,12 @@ variable_obj_command (ClientData clientData, Tcl_Interp *interp,
       break;
 
     case VARIABLE_CHILDREN:
+      from = to = -1;
+      if (objc > 2
+	  && variable_range (interp, objc, objv, &from, &to) != TCL_OK)
+	return TCL_ERROR;
       {
-	Tcl_Obj *children = variable_children (interp, var);
+	Tcl_Obj *children = variable_children (interp, var, from, to);
 	Tcl_SetObjResult (interp, children);
       }
       break;
@@ -282,11 +308,37 @@ variable_obj_command (ClientData clientData, Tcl_Interp *interp,
     case VARIABLE_UPDATE:
       /* Only root variables can be updated */
       {
-	Tcl_Obj *obj = variable_update (interp, &var);
+	int records_p = 0;
+
+	if (objc > 2)
+	  {
+	    int len;
+	    char *s = Tcl_GetStringFromObj (objv[2], &len);
+	    if (len < 2 || strncmp (s, "-records", len) != 0)
+	      {
+		Tcl_WrongNumArgs (interp, 2, objv, "?-records?");
+		return TCL_ERROR;
+	      }
+	    records_p = 1;
+	  }
+
+	Tcl_Obj *obj = variable_update (interp, &var, records_p);
 	Tcl_SetObjResult (interp, obj);
       }
       break;
 
+    case VARIABLE_RELEASE:
+      from = to = 0;
+      if (objc > 2
+	  && variable_range (interp, objc, objv, &from, &to) != TCL_OK)
+	return TCL_ERROR;
+      variable_release (interp, var, from, to);
+      break;
+
+    case VARIABLE_ADDRESS:
+      variable_address (interp, var);
+      break;
+
     default:
       return TCL_ERROR;
     }
@@ -294,6 +346,35 @@ variable_obj_command (ClientData clientData, Tcl_Interp *interp,
   return result;
 }
 
+/* Parse the "OFFSET COUNT" arguments of the children and release
+   object commands into the child index range [*FROM, *TO). */
+static int
+variable_range (Tcl_Interp *interp, int objc, Tcl_Obj *CONST objv[],
+		int *from, int *to)
+{
+  int offset, count;
+
+  if (objc != 4)
+    {
+      Tcl_WrongNumArgs (interp, 2, objv, "?offset count?");
+      return TCL_ERROR;
+    }
+
+  if (Tcl_GetIntFromObj (interp, objv[2], &offset) != TCL_OK
+      || Tcl_GetIntFromObj (interp, objv[3], &count) != TCL_OK)
+    return TCL_ERROR;
+
+  if (offset < 0 || count < 0)
+    {
+      gdbtk_set_result (interp, "offset and count must not be negative");
+      return TCL_ERROR;
+    }
+
+  *from = offset;
+  *to = offset + count;
+  return TCL_OK;
+}
+
 /*
  * Variable object construction/destruction
  */
@@ -429,13 +510,16 @@ variable_delete (Tcl_Interp *interp, struct varobj *var,
   varobj_delete (var, only_children_p);
 }
 
-/* Return a list of all the children of VAR, creating them if necessary. */
+/* Return a list of the children of VAR in the index range [FROM, TO),
+   or of all of them if FROM or TO is negative, creating them if
+   necessary.  Only the children returned are created (see
+   patches/binutils-gdb/009-varobj-list-children-range.patch) and get
+   a Tcl command, so that a large array or container costs nothing for
+   the elements that are never displayed.  */
 static Tcl_Obj *
-variable_children (Tcl_Interp *interp, struct varobj *var)
+variable_children (Tcl_Interp *interp, struct varobj *var, int from, int to)
 {
   Tcl_Obj *list = Tcl_NewListObj (0, NULL);
-  int from = -1;
-  int to = -1;
   const std::vector<varobj *> &children =
                                         varobj_list_children (var, &from, &to);
   const char *childname;
@@ -456,11 +540,68 @@ variable_children (Tcl_Interp *interp, struct varobj *var)
   return list;
 }
 
+/* Delete the children of VAR outside of the index range [FROM, TO),
+   along with their own children and Tcl commands.  Their slots are
+   left empty, and the next request for them creates them again.  */
+static void
+variable_release (Tcl_Interp *interp, struct varobj *var, int from, int to)
+{
+  int ix;
+
+  for (ix = 0; ix < (int) var->children.size (); ++ix)
+    {
+      varobj *child = var->children[ix];
+
+      if (child == NULL || (ix >= from && ix < to))
+	continue;
+
+      /* This also clears the slot of CHILD in VAR->children.  */
+      variable_delete (interp, child, 0);
+    }
+}
+
+/* Set the result to the {START END} range of memory, END excluded,
+   holding the value of VAR, or to an empty string if the value is not
+   in memory (e.g. it lives in a register) or is not known.  */
+static void
+variable_address (Tcl_Interp *interp, struct varobj *var)
+{
+  struct value *val = var->value.get ();
+
+  Tcl_ResetResult (interp);
+  if (val == NULL || VALUE_LVAL (val) != lval_memory)
+    return;
+
+  try
+    {
+      CORE_ADDR start = value_address (val);
+      CORE_ADDR end = start + TYPE_LENGTH (check_typedef (value_type (val)));
+      Tcl_Obj *elems[2];
+
+      elems[0] = Tcl_NewStringObj (core_addr_to_string (start), -1);
+      elems[1] = Tcl_NewStringObj (core_addr_to_string (end), -1);
+      Tcl_SetObjResult (interp, Tcl_NewListObj (2, elems));
+    }
+  catch (const gdb_exception_error &)
+    {
+      /* The size of the type is not known.  */
+    }
+}
+
 /* Update the values for a variable and its children. */
 /* NOTE:   Only root variables can be updated... */
 
+/* Without RECORDS_P, the result is the list of the names of the
+   objects whose value changed, or "-1" if the variable could not be
+   updated.  With RECORDS_P, each element of the list is instead a
+   record {NAME VALUE ERROR TYPE_CHANGED NUM_CHILDREN} giving the
+   printed value of the object (or the error message when ERROR is 1),
+   whether its type changed and its new number of children, so that
+   callers can refresh their display without querying every object
+   again.  */
+
 static Tcl_Obj *
-variable_update (Tcl_Interp *interp, struct varobj **var)
+variable_update (Tcl_Interp *interp, struct varobj **var, int records_p)
 {
   Tcl_Obj *changed;
   std::vector<varobj_update_result> changes;
@@ -477,6 +618,22 @@ variable_update (Tcl_Interp *interp, struct varobj **var)
 	case VAROBJ_IN_SCOPE:
 	  {
 	    Tcl_Obj *v = Tcl_NewStringObj (varobj_get_objname (r->varobj), -1);
+
+	    if (records_p)
+	      {
+		Tcl_Obj *record[5];
+		std::string value;
+		int ok = variable_print_value (r->varobj, value);
+
+		record[0] = v;
+		record[1] = Tcl_NewStringObj (value.c_str (), -1);
+		record[2] = Tcl_NewBooleanObj (!ok);
+		record[3] = Tcl_NewBooleanObj (r->type_changed);
+		record[4] =
+		  Tcl_NewIntObj (varobj_get_num_children (r->varobj));
+		v = Tcl_NewListObj (5, record);
+	      }
+
 	    Tcl_ListObjAppendElement (NULL, changed, v);
 	  }
 	  break;
@@ -628,9 +785,27 @@ variable_value (Tcl_Interp *interp, int objc,
 static int
 variable_print (Tcl_Interp *interp, int objc,
 		Tcl_Obj *CONST objv[], struct varobj *var)
+{
+  std::string value;
+
+  if (!variable_print_value (var, value))
+    {
+      gdbtk_set_result (interp, "%s", value.c_str ());
+      return TCL_ERROR;
+    }
+
+  Tcl_SetObjResult (interp, Tcl_NewStringObj (value.c_str (), -1));
+  return TCL_OK;
+}
+
+/* Helper functions for the above */
+
+/* Format the value of VAR for printing into RESULT.  Return 1 on
+   success; otherwise return 0 with the error message in RESULT. */
+static int
+variable_print_value (struct varobj *var, std::string &result)
 {
   string_file stream;
-  int ret = TCL_ERROR;
 
   try
     {
@@ -640,19 +815,16 @@ variable_print (Tcl_Interp *interp, int objc,
       opts.deref_ref = 1;
       opts.raw = 0;
       common_val_print (var->value.get (), &stream, 0, &opts, current_language);
-      Tcl_SetObjResult (interp, Tcl_NewStringObj (stream.data (), -1));
-      ret = TCL_OK;
+      result = std::move (stream.string ());
+      return 1;
     }
   catch (const gdb_exception_error &except)
     {
-      gdbtk_set_result (interp, "<error reading variable: %s>", except.message);
+      result = string_printf ("<error reading variable: %s>", except.what ());
+      return 0;
     }
-
-  return ret;
 }
 
-/* Helper functions for the above */
-
 /* Install the given variable VAR into the tcl interpreter with
    the object name NAME. */
 static void
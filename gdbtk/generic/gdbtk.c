@@ -70,6 +70,7 @@
 #include <signal.h>
 
 #include <string.h>
+#include <algorithm>
 #include "dis-asm.h"
 #include "gdbcmd.h"
 #include "gdb_select.h"
@@ -92,8 +93,33 @@ x_event_wrapper (int signo)
 {
   x_event (signo);
 }
+
+/* In event driven mode, the GUI is instead woken up by a SIGIO on the
+   file descriptors Tk watches, e.g. the connection to the X server,
+   and serviced at most gdbtk_max_redraw_rate times per second.  */
+#if defined (F_SETOWN) && defined (O_ASYNC)
+#define GDBTK_IO_WAKEUP 1
+static struct sigaction act_io;
+static struct timeval gdbtk_last_wakeup;
+static volatile int gdbtk_wakeup_pending = 0;
+static int gdbtk_io_wakeup_going = 0;
+
+static void gdbtk_wakeup (int signo);
+static void gdbtk_arm_wakeup (long usec);
+static int gdbtk_start_io_wakeup (void);
+static void gdbtk_stop_io_wakeup (void);
+#endif
 #endif
 
+/* Linked to the Tcl variable "gdbtk_event_driven": keep the GUI alive
+   while the inferior runs from its own events rather than from a
+   periodic timer.  */
+int gdbtk_event_driven = 0;
+
+/* Linked to the Tcl variable "gdbtk_max_redraw_rate": in event driven
+   mode, the maximum number of times per second the GUI is serviced. */
+int gdbtk_max_redraw_rate = 20;
+
 /* This variable holds the main process id. */
 
 long gdbtk_pid = -1;
@@ -429,6 +455,11 @@ gdbtk_notifier_set_timer (CONST86 Tcl_Time *timeptr)
   (void) timeptr;
 }
 
+/* While set, gdbtk_notifier_wait_for_event does not wait: it stores
+   the time Tcl would wait in gdbtk_notifier_timeout.  */
+static int gdbtk_notifier_probing = 0;
+static int gdbtk_notifier_timeout;
+
 /* Tcl notifier procedure to wait for an event.
  * Use gdb event loop wait function. */
 static int
@@ -438,9 +469,31 @@ gdbtk_notifier_wait_for_event (CONST86 Tcl_Time *timeptr)
 
   if (timeptr)
     msec = timeptr->sec * 1000 + (timeptr->usec + 500) / 1000;
+  if (gdbtk_notifier_probing)
+    {
+      gdbtk_notifier_timeout = msec;
+      return -1;
+    }
   return gdb_do_one_event (msec);
 }
 
+/* Return the number of milliseconds before Tcl has a timer to run, 0
+   if it has something to do already, or -1 if it only waits for
+   input.  Tcl computes it while setting up its event sources, before
+   it waits: the wait is cut short by gdbtk_notifier_wait_for_event.  */
+static int
+gdbtk_notifier_next_timeout (void)
+{
+  gdbtk_notifier_probing = 1;
+  gdbtk_notifier_timeout = 0;
+
+  /* Tcl services a queued event instead of waiting, if there is one.  */
+  while (Tcl_DoOneEvent (TCL_ALL_EVENTS) != 0)
+    ;
+  gdbtk_notifier_probing = 0;
+  return gdbtk_notifier_timeout;
+}
+
 /* Tcl notifier procedure to delete a file handler.
    Remove it from the gdb queue. */
 static void
@@ -614,8 +667,13 @@ gdbtk_start_timer (void)
       if (!gdbtk_timer_going)
 	{
 #ifndef __MINGW32__
-	  sigaction (SIGALRM, &act1, NULL);
-	  setitimer (ITIMER_REAL, &it_on, NULL);
+#ifdef GDBTK_IO_WAKEUP
+	  if (!gdbtk_event_driven || !gdbtk_start_io_wakeup ())
+#endif
+	    {
+	      sigaction (SIGALRM, &act1, NULL);
+	      setitimer (ITIMER_REAL, &it_on, NULL);
+	    }
 #endif
 	  gdbtk_timer_going = 1;
 	}
@@ -631,6 +689,9 @@ gdbtk_stop_timer (void)
     {
       gdbtk_timer_going = 0;
 #ifndef __MINGW32__
+#ifdef GDBTK_IO_WAKEUP
+      gdbtk_stop_io_wakeup ();
+#endif
       setitimer (ITIMER_REAL, &it_off, NULL);
       sigaction (SIGALRM, &act2, NULL);
 #endif
@@ -638,6 +699,175 @@ gdbtk_stop_timer (void)
   return;
 }
 
+/* Return true if the X events Xlib has read are not all processed.
+   Those raise no SIGIO, having already been read from the connection.  */
+static int
+gdbtk_x_events_queued (void)
+{
+  Tk_Window main_window = Tk_MainWindow (gdbtk_get_interp ()->tcl);
+
+  return main_window != NULL && QLength (Tk_Display (main_window)) > 0;
+}
+
+/* Process the pending Tcl events, for x_event.  In event driven mode,
+   the GUI is then woken up again for the next Tcl timer, since nothing
+   else would wake it up then.  */
+void
+gdbtk_process_events (void)
+{
+  for (;;)
+    {
+      int count = 0;
+
+      while (Tcl_DoOneEvent (TCL_DONT_WAIT | TCL_ALL_EVENTS) != 0)
+	count++;
+      if (count == 0 || !gdbtk_x_events_queued ())
+	break;
+    }
+
+#ifdef GDBTK_IO_WAKEUP
+  if (gdbtk_io_wakeup_going)
+    {
+      int msec = gdbtk_notifier_next_timeout ();
+      long usec, wait;
+      struct timeval now, elapsed;
+
+      if (gdbtk_x_events_queued ())
+	msec = 0;
+      if (msec < 0 || gdbtk_wakeup_pending)
+	return;
+
+      /* Keep to the maximum redraw rate.  */
+      usec = msec * 1000L;
+      if (gdbtk_max_redraw_rate > 0)
+	{
+	  gettimeofday (&now, NULL);
+	  timersub (&now, &gdbtk_last_wakeup, &elapsed);
+	  wait = (1000000 / gdbtk_max_redraw_rate
+		  - elapsed.tv_sec * 1000000 - elapsed.tv_usec);
+	  usec = std::max (usec, wait);
+	}
+      gdbtk_arm_wakeup (usec);
+    }
+#endif
+}
+
+#ifdef GDBTK_IO_WAKEUP
+/* Wake the GUI up in USEC microseconds.  */
+static void
+gdbtk_arm_wakeup (long usec)
+{
+  struct itimerval it;
+
+  /* A zero delay would disarm the timer.  */
+  usec = std::max (usec, 1L);
+  memset (&it, 0, sizeof it);
+  it.it_value.tv_sec = usec / 1000000;
+  it.it_value.tv_usec = usec % 1000000;
+  gdbtk_wakeup_pending = 1;
+  setitimer (ITIMER_REAL, &it, NULL);
+}
+
+/* SIGIO (and SIGALRM) handler of the event driven mode.  Service the
+   GUI, unless it was serviced too recently: then wake up again once
+   the minimum interval has elapsed.  SIGALRM comes from the deferred
+   wakeups and from the Tcl timers.  */
+static void
+gdbtk_wakeup (int signo)
+{
+  struct timeval now, elapsed;
+  long interval, usec;
+
+  if (gdbtk_max_redraw_rate > 0)
+    {
+      interval = 1000000 / gdbtk_max_redraw_rate;
+      gettimeofday (&now, NULL);
+      timersub (&now, &gdbtk_last_wakeup, &elapsed);
+      usec = elapsed.tv_sec * 1000000 + elapsed.tv_usec;
+      if (usec >= 0 && usec < interval)
+	{
+	  if (!gdbtk_wakeup_pending)
+	    gdbtk_arm_wakeup (interval - usec);
+	  return;
+	}
+      gdbtk_last_wakeup = now;
+    }
+
+  gdbtk_wakeup_pending = 0;
+  x_event (signo);
+}
+
+/* Set or clear O_ASYNC on the file descriptors Tk watches for input.  */
+static int
+gdbtk_set_io_async (int on)
+{
+  gdbtk_notifier_file_data *data;
+  int count = 0;
+
+  for (data = notifier_state ()->filelist; data; data = data->next)
+    {
+      int flags;
+
+      if (!(data->mask & TCL_READABLE))
+	continue;
+
+      flags = fcntl (data->fd, F_GETFL);
+      if (flags == -1)
+	continue;
+
+      if (on)
+	{
+	  if (fcntl (data->fd, F_SETOWN, getpid ()) == -1
+	      || fcntl (data->fd, F_SETFL, flags | O_ASYNC) == -1)
+	    continue;
+	  count++;
+	}
+      else
+	fcntl (data->fd, F_SETFL, flags & ~O_ASYNC);
+    }
+
+  return count;
+}
+
+/* Start waking up the GUI on its input.  Return 0 if that is not
+   possible, so the caller should use the timer.  */
+static int
+gdbtk_start_io_wakeup (void)
+{
+  act_io.sa_handler = gdbtk_wakeup;
+  act_io.sa_mask = nullsigmask;
+  act_io.sa_flags = 0;
+  sigaction (SIGIO, &act_io, NULL);
+  sigaction (SIGALRM, &act_io, NULL);
+
+  if (gdbtk_set_io_async (1) == 0)
+    {
+      sigaction (SIGIO, &act2, NULL);
+      sigaction (SIGALRM, &act2, NULL);
+      return 0;
+    }
+
+  gdbtk_wakeup_pending = 0;
+  gdbtk_io_wakeup_going = 1;
+
+  /* Process what arrived before O_ASYNC was set.  */
+  gdbtk_wakeup (SIGIO);
+  return 1;
+}
+
+static void
+gdbtk_stop_io_wakeup (void)
+{
+  if (!gdbtk_io_wakeup_going)
+    return;
+
+  gdbtk_io_wakeup_going = 0;
+  gdbtk_set_io_async (0);
+  sigaction (SIGIO, &act2, NULL);
+  gdbtk_wakeup_pending = 0;
+}
+#endif
+
 /* Should this target use the timer? See comments before
    x_event for the logic behind all this. */
 static int
@@ -25,6 +25,7 @@
 #define _GDBTK_H
 
 #include "gdbtk-interp.h"
+#include <vector>
 
 #ifdef _WIN32
 #define GDBTK_PATH_SEP ";"
@@ -73,6 +74,14 @@ extern int disassemble_from_exec;
 
 extern int running_now;
 
+/* When true, the GUI is kept alive while the inferior runs by its own
+   input rather than by a periodic timer, and serviced at most
+   gdbtk_max_redraw_rate times per second.  They are defined in
+   gdbtk.c */
+
+extern int gdbtk_event_driven;
+extern int gdbtk_max_redraw_rate;
+
 /* This variable holds the main process id. */
 
 extern long gdbtk_pid;
@@ -157,6 +166,7 @@ extern void gdbtk_start_timer (void);
 extern long gdbtk_getpid(void);
 extern void gdbtk_ignorable_warning (const char *, const char *);
 extern int x_event (int);
+extern void gdbtk_process_events (void);
 extern int gdbtk_two_elem_cmd (char *, const char *);
 extern int target_is_native (struct target_ops *t);
 extern struct ui_file *gdbtk_fileopen (void);
@@ -194,4 +204,58 @@ extern void gdbtk_init (gdbtk_interp *);
 extern void gdbtk_source_start_file (gdbtk_interp *);
 
 extern void gdbtk_uninstall_notifier (void);
+
+/* Invalidate the memory cache shared by the gdbtk windows.  */
+extern void gdbtk_memory_cache_flush (void);
+extern void gdbtk_memory_cache_invalidate (CORE_ADDR addr, LONGEST len);
+
+/* Discard the disassembly cache of gdb_load_disassembly, or the part
+   of it covering some memory.  */
+extern void gdbtk_disassembly_cache_flush (void);
+extern void gdbtk_disassembly_cache_invalidate (CORE_ADDR addr,
+						LONGEST len);
+
+/* Discard the executable lines of the symtabs, see
+   gdb_executable_lines.  */
+extern void gdbtk_executable_lines_flush (void);
+
+/* Discard the function names indexed by gdb_search_functions.  */
+extern void gdbtk_function_index_flush (void);
+
+/* Discard the stack frame names cached by gdb_stack.  */
+extern void gdbtk_stack_cache_flush (void);
+
+/* Discard the register snapshot of gdb_reginfo.  */
+extern void gdbtk_register_cache_flush (void);
+
+/* Categories of target state which the GUI must update, see
+   gdbtk_schedule_update.  */
+#define GDBTK_UPDATE_REGISTERS		0x01
+#define GDBTK_UPDATE_MEMORY		0x02
+#define GDBTK_UPDATE_BREAKPOINTS	0x04
+#define GDBTK_UPDATE_CONTEXT		0x08
+
+/* Mark WHAT (GDBTK_UPDATE_* flags) as changed and queue a single
+   update of the windows for the next time the event loop is idle.  */
+extern void gdbtk_schedule_update (int what);
+
+/* Return the categories changed since the last call, and forget
+   them.  If RANGES is not NULL, it is set to the merged [start, end)
+   address ranges written since then; it is left empty when
+   GDBTK_UPDATE_MEMORY is set but the ranges are not known.  */
+extern int gdbtk_take_dirty
+  (std::vector<std::pair<CORE_ADDR, CORE_ADDR>> *ranges);
+
+/* Hand the console, log and target output batched by gdbtk_file to
+   Tcl now.  */
+extern void gdbtk_flush_output (void);
+
+/* Append output to the text kept for the console window, see
+   gdb_console.  */
+extern void gdbtk_console_log_append (const char *tag, const char *text,
+				      size_t len);
+
+/* Hand the breakpoint changes queued since the last call to the
+   windows, in a single Tcl call.  */
+extern void gdbtk_flush_breakpoints (void);
 #endif /* !_GDBTK_H */
@@ -153,10 +153,17 @@ proc gdbtk_busy {} {
 #          Use this procedure to force all widgets to update
 #          themselves. This hook is usually run after command
 #          that could change target state.
+#          DIRTY lists what changed (see gdb_dirty), or is "all".
+#          RANGES lists the memory written, if known.
 # ------------------------------------------------------------------
-proc gdbtk_update {} {
+proc gdbtk_update {{dirty all} {ranges {}}} {
 
-  set e [UpdateEvent \#auto]
+  if {$dirty == "all"} {
+    # This covers any update gdb has scheduled.
+    gdb_dirty
+  }
+
+  set e [UpdateEvent \#auto -dirty $dirty -ranges $ranges]
   GDBEventHandler::dispatch $e
   delete object $e
 
@@ -171,17 +178,22 @@ proc gdbtk_update {} {
 #          themselves. This hook is usually run after command
 #          that could change target state.
 #          Like gdbtk_update but safe to be used in "after idle"
-#          which is used in update hooks.
+#          which is used in update hooks.  Only what changed since
+#          the last update is updated.
 # ------------------------------------------------------------------
 proc gdbtk_update_safe {} {
   global gdb_running
 
   # Fencepost: Do not update if we are running the target
   # We get here because script commands may have changed memory or
-  # registers and "after idle" events registered as a consequence
+  # registers and gdb scheduled an update as a consequence.
   # If we try to update while the target is running we are doomed.
+  # What changed stays pending until the target stops.
   if {!$gdb_running} {
-    gdbtk_update
+    lassign [gdb_dirty] dirty ranges
+    if {$dirty != {}} {
+      gdbtk_update $dirty $ranges
+    }
   }
 }
 
@@ -417,7 +429,8 @@ proc gdbtk_tcl_ignorable_warning {class message} {
 }
 
 # ------------------------------------------------------------------
-# PROC: gdbtk_tcl_fputs -
+# PROC: gdbtk_tcl_fputs - show gdb output.  gdb_console already has
+#       MESSAGE.
 # ------------------------------------------------------------------
 proc gdbtk_tcl_fputs {message} {
   global gdbtk_state
@@ -425,7 +438,7 @@ proc gdbtk_tcl_fputs {message} {
   gdb_restore_write
 
   if {[info exists gdbtk_state(console)] &&   $gdbtk_state(console) != ""} {
-    $gdbtk_state(console) insert $message
+    $gdbtk_state(console) update_output
   }
 }
 
@@ -433,7 +446,12 @@ proc gdbtk_tcl_fputs {message} {
 # PROC: echo -
 # ------------------------------------------------------------------
 proc echo {args} {
-  gdbtk_tcl_fputs [concat $args]\n
+  global gdbtk_state
+  if {[info exists gdbtk_state(console)] && $gdbtk_state(console) != ""} {
+    $gdbtk_state(console) insert [concat $args]\n
+  } else {
+    gdb_console append {} [concat $args]\n
+  }
 }
 
 # ------------------------------------------------------------------
@@ -443,27 +461,31 @@ proc gdbtk_tcl_fputs_error {message} {
   if {[info exists ::gdbtk_state(console)] && $::gdbtk_state(console) != ""} {
     $::gdbtk_state(console) insert $message err_tag
     update
+  } else {
+    gdb_console append err_tag $message
   }
 }
 
 # ------------------------------------------------------------------
-# PROC: gdbtk_tcl_fputs_log - write a log message
+# PROC: gdbtk_tcl_fputs_log - show a log message.  gdb_console
+#       already has MESSAGE.
 # ------------------------------------------------------------------
 proc gdbtk_tcl_fputs_log {message} {
   if {[info exists ::gdbtk_state(console)] && $::gdbtk_state(console) != ""} {
-    $::gdbtk_state(console) insert $message log_tag
+    $::gdbtk_state(console) update_output
     update
   }
 }
 
 # ------------------------------------------------------------------
-# PROC: gdbtk_tcl_fputs_target - write target output
+# PROC: gdbtk_tcl_fputs_target - show target output.  gdb_console
+#       already has MESSAGE.
 # ------------------------------------------------------------------
 proc gdbtk_tcl_fputs_target {message} {
   if {$::gdbtk_state(console) == ""} {
     ManagedWin::open Console -force
   }
-  $::gdbtk_state(console) insert $message target_tag
+  $::gdbtk_state(console) update_output
   update
 }
 
@@ -501,36 +523,22 @@ proc gdbtk_tcl_end_variable_annotation {} {
 }
 
 # ------------------------------------------------------------------
-# PROC: gdbtk_tcl_breakpoint - A breakpoint was changed -- notify
-#                               gui.
-# ------------------------------------------------------------------
-proc gdbtk_tcl_breakpoint {action bpnum} {
-#  debug "BREAKPOINT: $action $bpnum"
-  set e [BreakpointEvent \#auto -action $action -number $bpnum]
-  GDBEventHandler::dispatch $e
-  delete object $e
-}
-
-# ------------------------------------------------------------------
-# PROC: gdbtk_tcl_tracepoint - A tracepoint was changed -- notify
-#                               gui.
-# ------------------------------------------------------------------
-proc gdbtk_tcl_tracepoint {action tpnum} {
-#  debug "TRACEPOINT: $action $tpnum"
-  set e [TracepointEvent \#auto -action $action -number $tpnum]
-  GDBEventHandler::dispatch $e
-  delete object $e
-}
-
-# ------------------------------------------------------------------
-# PROC: gdbtk_tcl_watchpoint - A watchpoint was changed -- notify
-#                               gui.
-# ------------------------------------------------------------------
-proc gdbtk_tcl_watchpoint {action num} {
-#  debug "WATCHPOINT: $action $num"
-  set e [WatchpointEvent \#auto -action $action -number $num]
-  GDBEventHandler::dispatch $e
-  delete object $e
+# PROC: gdbtk_tcl_breakpoints - Breakpoints, tracepoints or
+#                               watchpoints were changed -- notify gui.
+#
+#  CHANGES is a list of {kind action number info ...}, in order,
+#  where KIND is breakpoint, tracepoint or watchpoint and INFO the
+#  info of the point.  All of them are dispatched before the windows
+#  get to redraw.
+# ------------------------------------------------------------------
+proc gdbtk_tcl_breakpoints {changes} {
+  foreach {kind action number info} $changes {
+#    debug "[string toupper $kind]: $action $number"
+    set e [[string toupper $kind 0 0]Event \#auto -action $action \
+             -data $info -number $number]
+    GDBEventHandler::dispatch $e
+    delete object $e
+  }
 }
 
 # ------------------------------------------------------------------
@@ -686,25 +694,6 @@ proc gdbtk_tcl_display {action number {value {}}} {
   run_hooks gdb_display_change_hook $action $number $value
 }
 
-# ------------------------------------------------------------------
-#  PROCEDURE: gdbtk_register_changed
-#         This hook is called from value_assign to inform us that
-#         the user has changed the contents of a register.
-# ------------------------------------------------------------------
-proc gdbtk_register_changed {} {
-  after idle gdbtk_update_safe
-}
-
-# ------------------------------------------------------------------
-#  PROCEDURE: gdbtk_memory_changed
-#         This hook is called from value_assign to inform us that
-#         the user has changed the contents of memory (including
-#         the program's variables).
-# ------------------------------------------------------------------
-proc gdbtk_memory_changed {} {
-  after idle gdbtk_update_safe
-}
-
 ####################################################################
 #                                                                  #
 #                           FILE HOOKS                             #
@@ -153,6 +153,20 @@ itcl::class LocalsWin {
 
   method update {event} {
     debug
+    # "dummy" forces a refresh
+    if {$event != "dummy"} {
+      if {![$event changed registers memory context]} {
+	return
+      }
+
+      # If only memory was written, the frame and its variables
+      # are the same.
+      set ranges [$event changed_ranges]
+      if {$ranges != "all"} {
+	after idle [code $tree update 0 $ranges]
+	return
+      }
+    }
 
     # Check that a context switch has not occured
     if {[context_switch]} {
@@ -158,6 +158,10 @@ pref_read
 
 init_disassembly_flavor
 
+# how to keep the GUI alive while the target runs
+set gdbtk_event_driven [pref get gdb/event_driven]
+set gdbtk_max_redraw_rate [pref get gdb/max_redraw_rate]
+
 # initialize state variables
 initialize_gdbtk
 
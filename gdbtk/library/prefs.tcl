@@ -304,6 +304,9 @@ proc pref_set_defaults {} {
   # 1 means set/clear tracepoints.
   pref define gdb/use_icons		  1;	 # For Unix, use gdbtk_icon.gif as an icon
   # some window managers can't deal with it.
+  pref define gdb/event_driven            1;     # While the target runs, wake the GUI
+  # on its own input and timers (1) or periodically (0).
+  pref define gdb/max_redraw_rate         20;    # Times per second at most
 
   # OS compatibility. Valid values are "Windows", "GNOME", "KDE", and "default"
   if {$gdbtk_platform(platform) == "windows"}  {
@@ -340,6 +343,8 @@ proc pref_set_defaults {} {
   pref define gdb/console/log_fg          \#00b300
   pref define gdb/console/target_fg       blue
   pref define gdb/console/font            global/fixed
+  pref define gdb/console/history_lines   20000
+  pref define gdb/console/history_bytes   4194304
 
   # Source window defaults
   pref define gdb/src/PC_TAG              \#00b300
@@ -390,6 +395,7 @@ proc pref_set_defaults {} {
   # Browser Window Search
   pref define gdb/search/last_symbol      ""
   pref define gdb/search/filter_mode     "starts with"
+  pref define gdb/search/max_functions   20000
 
   pref define gdb/browser/hide_h          0
   pref define gdb/browser/layout	2
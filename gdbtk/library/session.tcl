@@ -52,10 +52,13 @@ namespace eval Session {
       set debugging_gdb 0
     }
 
-    foreach bp_num [gdb_get_breakpoint_list] {
-      lassign [gdb_get_breakpoint_info $bp_num] file function line_number \
-	address type enabled disposition ignore_count command_list \
-	condition thread hit_count
+    lassign [lassign [gdb_get_point_info breakpoints] gen deleted bp_nums] \
+      files functions line_numbers addresses types enables dispositions \
+      ignore_counts command_lists conditions
+    foreach bp_num $bp_nums file $files function $functions \
+      line_number $line_numbers address $addresses enabled $enables \
+      disposition $dispositions command_list $command_lists \
+      condition $conditions {
 
       # These breakpoints are set when debugging GDB with itself.
       # Ignore them so they don't accumulate. They get set again
@@ -62,6 +62,10 @@ itcl::class TdumpWin {
   # ------------------------------------------------------------------
   method update {event} {
     #debug "tdump: update"
+    # "dummy" forces a refresh
+    if {$event != "dummy" && ![$event changed registers memory context]} {
+      return
+    }
     gdbtk_busy
     set tframe_num [gdb_get_trace_frame_num]
 
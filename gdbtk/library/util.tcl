@@ -171,11 +171,9 @@ proc bp_exists {linespec} {
 
   lassign $linespec foo function filename line_number addr pc_addr
 
-  set bps [gdb_get_breakpoint_list]
-  foreach bpnum $bps {
-    set bpinfo [gdb_get_breakpoint_info $bpnum]
-    lassign $bpinfo file func line pc type enabled disposition \
-      ignore_count commands cond thread hit_count
+  lassign [lassign [gdb_get_point_info breakpoints] gen deleted bps] \
+    files funcs lines pcs
+  foreach bpnum $bps file $files func $funcs pc $pcs {
     if {$filename == $file && $function == $func && $addr == $pc} {
       return $bpnum
     }
@@ -184,6 +182,25 @@ proc bp_exists {linespec} {
   return -1
 }
 
+# ------------------------------------------------------------------
+#  PROCEDURE:  ranges_overlap
+#            Returns 1 if the memory from START to END (excluded)
+#            overlaps one of the {start end} RANGES, as returned by
+#            UpdateEvent::changed_ranges, or if RANGES is "all".
+# ------------------------------------------------------------------
+proc ranges_overlap {ranges start end} {
+  if {$ranges == "all"} {
+    return 1
+  }
+  foreach range $ranges {
+    lassign $range lo hi
+    if {$lo < $end && $start < $hi} {
+      return 1
+    }
+  }
+  return 0
+}
+
 
 # gridCGet - This provides the missing grid cget
 # command.
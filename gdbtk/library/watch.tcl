@@ -245,7 +245,9 @@ itcl::class WatchWin {
 
 
   method update {event} {
-    $tree update
+    if {[$event changed registers memory context]} {
+      $tree update 0 [$event changed_ranges]
+    }
   }
 
 